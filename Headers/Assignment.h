@@ -0,0 +1,38 @@
+// ---------------------------------------------------------------------------
+// Assignment.h
+// Solves the assignment problem: pairs every row of a cost matrix with its
+// own column so the summed cost of the pairs is least. The matrix is given
+// sparse, as the arcs of each row; missing pairs can't be made.
+// ---------------------------------------------------------------------------
+
+#ifndef _ASSIGNMENT_
+#define _ASSIGNMENT_
+
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Arc
+// Purpose: Pair a row can be assigned, and its cost.
+// ---------------------------------------------------------------------------
+struct Arc{
+	int col;
+	double cost;	// Not negative
+};
+
+// ---------------------------------------------------------------------------
+// Solve_Assignment
+// Purpose: Least cost assignment of rows to distinct columns by shortest
+//			augmenting paths (Jonker-Volgenant), each found with Dijkstra's
+//			algorithm over the arcs, so costs grow with the arcs explored
+//			rather than the size of the full matrix.
+//
+// Parameters:
+//		1: Arcs of each row. Every row must be assignable at once, such as
+//		   when each row has a column of its own
+//		2: Number of columns
+//
+// Returns: Column of each row
+// ---------------------------------------------------------------------------
+std::vector< int > solve_assignment( const std::vector< std::vector< Arc > >& arcs, const int cols );
+
+#endif
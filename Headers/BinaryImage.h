@@ -10,6 +10,20 @@
 #define _BINARYIMAGE_
 
 #include "Image.h"
+#include "PackedBinaryImage.h"
+
+// ---------------------------------------------------------------------------
+// ThresholdMethod
+// Purpose: Ways of picking the threshold automatically. The global methods
+//			pick one threshold from the histogram, the adaptive ones pick
+//			one per pixel from the window of pixels around it.
+// ---------------------------------------------------------------------------
+enum ThresholdMethod{
+	THRESHOLD_OTSU,		// Maximize between-class variance of the histogram
+	THRESHOLD_TRIANGLE,	// Farthest histogram bin from the peak-to-tail line
+	THRESHOLD_MEAN,		// Adaptive: brighter than the local mean by k of the headroom
+	THRESHOLD_SAUVOLA	// Adaptive: Sauvola's mean and deviation threshold
+};
 
 class BinaryImage : public Image{
 
@@ -36,19 +50,107 @@ public:
 	// ---------------------------------------------------------------------------
 	BinaryImage( const char*, const int );
 
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Constructs a binary image from an image, picking the threshold
+	//			value automatically.
+	//
+	// Parameters:
+	//		Parameter 1: Image object initialized with greyscale image
+	//		Parameter 2: Threshold method
+	//		Parameter 3: Adaptive methods: width and height of the window
+	//		Parameter 4: Adaptive methods: sensitivity k
+	// ---------------------------------------------------------------------------
+	BinaryImage( const Image&, const ThresholdMethod, const int = 31, const double = 0.2 );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Constructs a binary image from an image file, picking the 
+	//			threshold value automatically.
+	//
+	// Parameters:
+	//		Parameter 1: Image file path
+	//		Parameter 2: Threshold method
+	//		Parameter 3: Adaptive methods: width and height of the window
+	//		Parameter 4: Adaptive methods: sensitivity k
+	// ---------------------------------------------------------------------------
+	BinaryImage( const char*, const ThresholdMethod, const int = 31, const double = 0.2 );
+
 	~BinaryImage( void );
 
+	// ---------------------------------------------------------------------------
+	// PACK
+	// Purpose: Packs this binary image into one bit per pixel.
+	//
+	// Returns: Packed image with every non-zero pixel set
+	// ---------------------------------------------------------------------------
+	PackedBinaryImage pack( void ) const;
+
+	// ---------------------------------------------------------------------------
+	// GETTHRESHOLD
+	// Purpose: Threshold value the image was converted with, -1 if it was
+	//			converted with an adaptive method.
+	// ---------------------------------------------------------------------------
+	int getThreshold( void ) const{ return threshold; }
+
 private:
 
+	// Threshold value the image was converted with
+	int threshold;
+
+	// ---------------------------------------------------------------------------
+	// PICK_THRESHOLD
+	// Purpose: Computes the threshold value for a method from the histogram.
+	//
+	// Parameters:
+	//		Parameter 1: Greyscale image
+	//		Parameter 2: Threshold method
+	// ---------------------------------------------------------------------------
+	static int pick_threshold( const Image& greyscale, const ThresholdMethod method );
+
+	// ---------------------------------------------------------------------------
+	// READ_GREYSCALE
+	// Purpose: Maps an image file, throwing if it can't be read.
+	//
+	// Parameters:
+	//		Parameter 1: Image file path
+	//		Parameter 2: Out: greyscale image
+	// ---------------------------------------------------------------------------
+	static void read_greyscale( const char* file, Image& greyscale );
+
 	// ---------------------------------------------------------------------------
 	// GREYSCALE_TO_BINARY
 	// Purpose: Converts a greyscale image to a binary image using a threshold 
-	//			value.
+	//			value, writing the result into this image.
 	//
 	// Parameters:
-	//		Parameter 1: Threshold value
+	//		Parameter 1: Greyscale image
+	//		Parameter 2: Threshold value
+	// ---------------------------------------------------------------------------
+	void greyscale_to_binary( const Image& greyscale, const int threshold_value );
+
+	// ---------------------------------------------------------------------------
+	// ADAPTIVE_TO_BINARY
+	// Purpose: Converts a greyscale image to a binary image with a threshold
+	//			computed for every pixel from the window around it. Window
+	//			sums come from summed-area tables, so the cost per pixel does
+	//			not depend on the window size.
+	//
+	// Parameters:
+	//		Parameter 1: Greyscale image
+	//		Parameter 2: THRESHOLD_MEAN or THRESHOLD_SAUVOLA
+	//		Parameter 3: Width and height of the window
+	//		Parameter 4: Sensitivity k
+	// ---------------------------------------------------------------------------
+	void adaptive_to_binary( const Image& greyscale, const ThresholdMethod method,
+							 const int window_size, const double k );
+
+	// ---------------------------------------------------------------------------
+	// CONVERT
+	// Purpose: Converts with the global or adaptive method given.
 	// ---------------------------------------------------------------------------
-	void greyscale_to_binary( const int threshold_value );
+	void convert( const Image& greyscale, const ThresholdMethod method,
+				  const int window_size, const double k );
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef CONCURRENT_DISJ_SETS_H
+#define CONCURRENT_DISJ_SETS_H
+
+// ConcurrentDisjSets class
+//
+// CONSTRUCTION: with int representing number of sets
+//
+// ******************PUBLIC OPERATIONS*********************
+// void union( x, y )         --> Merge the sets containing x and y
+// int find( x )              --> Return set containing x
+// int size( )                --> Return number of elements
+// ******************ERRORS********************************
+// No error checking is performed
+
+#include <atomic>
+#include <vector>
+
+/**
+ * Disjoint set class safe to use from many threads at once, without locks.
+ * Unions link the root with the larger index under the one with the
+ * smaller index with a compare-and-swap, so the representative of a set
+ * is always its smallest element and parents only ever decrease.
+ * Finds use path halving.
+ * The number of elements is fixed at construction.
+ * Elements in the set are numbered starting at 0.
+ */
+class ConcurrentDisjSets
+{
+  public:
+    explicit ConcurrentDisjSets( int numElements = 0 );
+
+    int find( int x );
+    void unionSets( int x, int y );
+    int size( ) const { return parent.size( ); }
+
+  private:
+    std::vector< std::atomic<int> > parent;
+};
+
+#endif
@@ -0,0 +1,56 @@
+// ---------------------------------------------------------------------------
+// CpuLevel.h
+// Widest vector instruction set the CPU supports, detected once, so kernels
+// compiled for several instruction sets can pick theirs at run time.
+// ---------------------------------------------------------------------------
+
+#ifndef _CPULEVEL_
+#define _CPULEVEL_
+
+// Kernels for x86 instruction sets are only built on x86
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define CPU_X86
+#endif
+
+// ---------------------------------------------------------------------------
+// CpuLevel
+// Purpose: Instruction sets, each level implying the ones below it.
+// ---------------------------------------------------------------------------
+enum CpuLevel{
+	CPU_SCALAR,		// Plain C++ only
+	CPU_SSE2,
+	CPU_AVX2,
+	CPU_AVX512F,	// AVX-512 foundation: 32 and 64 bit lanes
+	CPU_AVX512BW	// AVX-512 with 8 and 16 bit lanes
+};
+
+// ---------------------------------------------------------------------------
+// Detect_Cpu_Level
+// Purpose: Asks the CPU which instruction sets it supports.
+// ---------------------------------------------------------------------------
+inline CpuLevel detect_cpu_level( void ){
+
+#ifdef CPU_X86
+	__builtin_cpu_init();
+
+	if( __builtin_cpu_supports( "avx512f" ) )
+		return __builtin_cpu_supports( "avx512bw" ) ? CPU_AVX512BW : CPU_AVX512F;
+	if( __builtin_cpu_supports( "avx2" ) )
+		return CPU_AVX2;
+	if( __builtin_cpu_supports( "sse2" ) )
+		return CPU_SSE2;
+#endif
+	return CPU_SCALAR;
+}
+
+// ---------------------------------------------------------------------------
+// Cpu_Level
+// Purpose: Widest instruction set this CPU supports, detected on first use.
+// ---------------------------------------------------------------------------
+inline CpuLevel cpu_level( void ){
+
+	static const CpuLevel level = detect_cpu_level();
+	return level;
+}
+
+#endif
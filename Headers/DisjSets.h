@@ -8,6 +8,8 @@
 // ******************PUBLIC OPERATIONS*********************
 // void union( root1, root2 ) --> Merge two sets
 // int find( x )              --> Return set containing x
+// int makeSet( )             --> Add a new set, return its element
+// int size( )                --> Return number of elements
 // ******************ERRORS********************************
 // No error checking is performed
 
@@ -22,11 +24,13 @@ using namespace std;
 class DisjSets
 {
   public:
-    explicit DisjSets( int numElements );
+    explicit DisjSets( int numElements = 0 );
 
     int find( int x ) const;
     int find( int x );
     void unionSets( int root1, int root2 );
+    int makeSet( );
+    int size( ) const { return s.size( ); }
 
   private:
     vector<int> s;
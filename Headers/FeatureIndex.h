@@ -0,0 +1,102 @@
+// ---------------------------------------------------------------------------
+// FeatureIndex.h
+// k-d tree over the shape features of an object database, to find the
+// entries nearest an object without comparing it to every entry.
+// ---------------------------------------------------------------------------
+
+#ifndef _FEATUREINDEX_
+#define _FEATUREINDEX_
+
+#include "ObjectInfo.h"
+#include "ObjectDatabase.h"
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Neighbour
+// Purpose: Database entry found near an object.
+// ---------------------------------------------------------------------------
+struct Neighbour{
+	int entry;			// Index of the record in the database
+	double distance;	// Feature distance to the object
+};
+
+class FeatureIndex{
+
+public:
+
+	// Features of an object: log area, log perimeter, log of the first Hu
+	// invariant and log elongation, each divided by the change that counts
+	// as one unit of distance
+	enum{ MAX_FEATURES = 4 };
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Builds the tree over every record of a database. If any record
+	//			lacks descriptors, only areas are indexed. The database must
+	//			outlive the index.
+	//
+	// Parameters:
+	//		Parameter 1: Database
+	// ---------------------------------------------------------------------------
+	explicit FeatureIndex( const ObjectDatabase& );
+
+	const ObjectDatabase& getDatabase( void ) const{ return database; }
+
+	// Number of features indexed, 1 or MAX_FEATURES
+	int getNFeatures( void ) const{ return dimensions; }
+
+	// ---------------------------------------------------------------------------
+	// Nearest
+	// Purpose: Finds the entries nearest an object in feature space.
+	//
+	// Parameters:
+	//		1: Object
+	//		2: Most entries to return
+	//		3: Farthest distance of an entry returned
+	//
+	// Returns: Up to k entries within the tolerance, nearest first
+	// ---------------------------------------------------------------------------
+	std::vector< Neighbour > nearest( const ObjectInfo&, const int k, const double tolerance ) const;
+
+	// ---------------------------------------------------------------------------
+	// Features
+	// Purpose: Scaled feature vector from an object's measurements.
+	//
+	// Parameters:
+	//		1: Area
+	//		2: Perimeter
+	//		3: First Hu invariant
+	//		4: Second Hu invariant
+	//		5: Number of features wanted, 1 or MAX_FEATURES
+	//		6: Feature vector out
+	// ---------------------------------------------------------------------------
+	static void features( const double area, const double perimeter, const double hu0,
+						  const double hu1, const int dimensions, double* point );
+
+private:
+
+	// ---------------------------------------------------------------------------
+	// Node
+	// Purpose: One database entry. Nodes [ first, last ) form a subtree whose
+	//			root is the middle node, splitting the rest on axis.
+	// ---------------------------------------------------------------------------
+	struct Node{
+		double point[ MAX_FEATURES ];
+		int entry;
+		int axis;
+	};
+
+	const ObjectDatabase& database;
+	int dimensions;
+	std::vector< Node > nodes;
+
+	void build( const int first, const int last );
+	void search( const int first, const int last, const double* query, const size_t k,
+				 double& radius2, std::vector< Neighbour >& best ) const;
+
+	// Not copyable, nor needed to be
+	FeatureIndex( const FeatureIndex& );
+	FeatureIndex& operator=( const FeatureIndex& );
+};
+
+#endif
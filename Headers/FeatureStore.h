@@ -0,0 +1,95 @@
+// ---------------------------------------------------------------------------
+// FeatureStore.h
+// Shape features of an object database, one contiguous column per feature,
+// scored against an object a batch of entries at a time. The distance
+// kernels use the widest instruction set the CPU supports (AVX-512, AVX2
+// or SSE2), picked at run time, with a plain C++ loop as the fallback.
+// ---------------------------------------------------------------------------
+
+#ifndef _FEATURESTORE_
+#define _FEATURESTORE_
+
+#include "ObjectInfo.h"
+#include "ObjectDatabase.h"
+#include "FeatureIndex.h"
+#include <vector>
+
+class FeatureStore{
+
+public:
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Copies the features of every record of a database into
+	//			columns, the same features FeatureIndex indexes. If any record
+	//			lacks descriptors, only areas are stored.
+	//
+	// Parameters:
+	//		Parameter 1: Database
+	//		Parameter 2: Weight of each feature in the distance, all 1 if 0
+	// ---------------------------------------------------------------------------
+	explicit FeatureStore( const ObjectDatabase&, const float* weights = 0 );
+
+	// Number of entries
+	size_t size( void ) const{ return count; }
+
+	// Number of features stored, 1 or FeatureIndex::MAX_FEATURES
+	int getNFeatures( void ) const{ return dimensions; }
+
+	// ---------------------------------------------------------------------------
+	// Distances
+	// Purpose: Weighted squared feature distances from an object to entries
+	//			[ first, first + length ).
+	//
+	// Parameters:
+	//		1: Object
+	//		2: First entry
+	//		3: Number of entries
+	//		4: Out: length distances
+	// ---------------------------------------------------------------------------
+	void distances( const ObjectInfo&, const size_t first, const size_t length, float* out ) const;
+
+	// ---------------------------------------------------------------------------
+	// Nearest
+	// Purpose: Finds the entries nearest an object by scoring every entry.
+	//
+	// Parameters:
+	//		1: Object
+	//		2: Most entries to return
+	//		3: Farthest distance of an entry returned
+	//
+	// Returns: Up to k entries within the tolerance, nearest first
+	// ---------------------------------------------------------------------------
+	std::vector< Neighbour > nearest( const ObjectInfo&, const int k, const double tolerance ) const;
+
+	// ---------------------------------------------------------------------------
+	// Within
+	// Purpose: Finds every entry within a distance of an object.
+	//
+	// Parameters:
+	//		1: Object
+	//		2: Farthest distance of an entry returned
+	//
+	// Returns: Entries within the tolerance, in database order
+	// ---------------------------------------------------------------------------
+	std::vector< Neighbour > within( const ObjectInfo&, const double tolerance ) const;
+
+	// ---------------------------------------------------------------------------
+	// Kernel_Name
+	// Purpose: Name of the instruction set the kernels run with on this CPU.
+	// ---------------------------------------------------------------------------
+	static const char* kernel_name( void );
+
+private:
+
+	size_t count;
+	int dimensions;
+
+	// Feature d of entry e is columns[ d ][ e ]
+	std::vector< float > columns[ FeatureIndex::MAX_FEATURES ];
+	float weights[ FeatureIndex::MAX_FEATURES ];
+
+	void query( const ObjectInfo&, float* point ) const;
+};
+
+#endif
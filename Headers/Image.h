@@ -11,16 +11,28 @@
 #ifndef _IMAGE
 #define _IMAGE
 
+#include <stddef.h>
+
+/* alignment (in bytes) of the pixel buffer and of every row in it, for
+   images that own their pixels (see setMapping for mapped ones) */
+#define IMAGE_ALIGNMENT 64
+
 class Image{
  private:
   int Nrows; /*number of rows */
   int Ncols; /*number of columns */
   int Ncolors; /*number of gray level colors */
-  int **image;
+  int Nstride; /*bytes from the start of one row to the next */
+  unsigned char *image; /*Nrows rows of Nstride bytes, one byte per pixel */
+  void *mapping; /*memory mapping the pixels live in, NULL if image is owned */
+  size_t mappingLength; /*length of the memory mapping */
+
+  void release();
 
  public:
   Image();
   Image (const Image &im);
+  Image (Image &&im); /* takes over im's pixels, leaving it empty */
   ~Image();
 
 /*
@@ -34,6 +46,19 @@ class Image{
 */
 int setSize(int rows, int columns);
 
+/*
+  makes the image a view of rows x columns pixels that already live
+    in a memory mapping (e.g. of a pgm file), starting at pixels and
+    stride bytes apart, instead of allocating and copying them;
+    the mapping [base, base+length) is unmapped when the image is
+    resized or destroyed;
+    rows of a mapped image start wherever the mapping puts them, so
+    unlike allocated images they need not be IMAGE_ALIGNMENT aligned;
+    returns rows * columns if OK or -2 if the size is invalid;
+*/
+int setMapping(unsigned char *pixels, int rows, int columns, int stride,
+	       void *base, size_t length);
+
 
 /*
   returns the number of columns in the image;
@@ -63,6 +88,19 @@ int getNRows()const{return Nrows;};
 */
  int getPixel( int i, int j )const;
 
+/*
+  raw access to the pixel buffer: rows are stored one after another,
+    getStride() bytes apart, and each row holds getNCols() pixels
+    starting at getRow(i); no bounds checking is done;
+*/
+ int getStride()const{ return Nstride; };
+ unsigned char *getData(){ return image; };
+ const unsigned char *getData()const{ return image; };
+ unsigned char *getRow( int i ){ return image + (long)i * Nstride; };
+ const unsigned char *getRow( int i )const{ return image + (long)i * Nstride; };
+ unsigned char *getRowEnd( int i ){ return getRow(i) + Ncols; };
+ const unsigned char *getRowEnd( int i )const{ return getRow(i) + Ncols; };
+
 };
 
 
@@ -73,7 +111,13 @@ int getNRows()const{return Nrows;};
 int
 readImage(Image *im, const char *filename);
 int
-writeImage(const Image *im, const char *filename);
+mapImage(Image *im, const char *filename);
+int
+writeImage(const Image *im, const char *filename, int quiet=0);
+int
+writeImageFd(const Image *im, int fd);
+long
+writeImageBuffer(const Image *im, unsigned char *buffer, size_t size);
 
 /*
 function for drawing a line
@@ -0,0 +1,64 @@
+// ---------------------------------------------------------------------------
+// IntegralImage.h
+// Summed-area tables of an image's grey levels and squared grey levels, so
+// the sum over any rectangle takes four lookups.
+// ---------------------------------------------------------------------------
+
+#ifndef _INTEGRALIMAGE_
+#define _INTEGRALIMAGE_
+
+#include "Image.h"
+#include <stdint.h>
+#include <vector>
+
+class IntegralImage{
+
+public:
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Builds the tables, each band of rows on its own thread.
+	//
+	// Parameters:
+	//		Parameter 1: Greyscale image
+	//		Parameter 2: Also build the table of squared grey levels?
+	// ---------------------------------------------------------------------------
+	IntegralImage( const Image&, const bool );
+
+	// ---------------------------------------------------------------------------
+	// Sum
+	// Purpose: Sum of the grey levels in rows [r0, r1) and columns [c0, c1).
+	// ---------------------------------------------------------------------------
+	uint64_t sum( const int r0, const int c0, const int r1, const int c1 ) const{
+		return rectangle( sums, r0, c0, r1, c1 );
+	}
+
+	// ---------------------------------------------------------------------------
+	// Sum_Squares
+	// Purpose: Sum of the squared grey levels in rows [r0, r1) and columns
+	//			[c0, c1). Only valid if the squares table was built.
+	// ---------------------------------------------------------------------------
+	uint64_t sum_squares( const int r0, const int c0, const int r1, const int c1 ) const{
+		return rectangle( squares, r0, c0, r1, c1 );
+	}
+
+private:
+
+	// Table width, one more than the image width
+	int width;
+
+	// ( rows + 1 ) x ( cols + 1 ) tables, entry ( i, j ) holds the total
+	// over rows [0, i) and columns [0, j)
+	std::vector< uint64_t > sums;
+	std::vector< uint64_t > squares;
+
+	uint64_t rectangle( const std::vector< uint64_t >& table,
+						const int r0, const int c0, const int r1, const int c1 ) const{
+
+		const uint64_t* top = &table[ (size_t)r0 * width ];
+		const uint64_t* bottom = &table[ (size_t)r1 * width ];
+		return bottom[ c1 ] - bottom[ c0 ] - top[ c1 ] + top[ c0 ];
+	}
+};
+
+#endif
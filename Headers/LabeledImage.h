@@ -11,7 +11,65 @@
 
 #include "Image.h"
 #include "ObjectInfo.h"
+#include "ObjectTable.h"
+#include "ObjectDatabase.h"
+#include "FeatureIndex.h"
+#include "FeatureStore.h"
+#include "PackedBinaryImage.h"
+#include "RunLengthImage.h"
+#include "DisjSets.h"
 #include <map>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// LabelingMethod
+// Purpose: Labeling engines. All of them give identical label images.
+// ---------------------------------------------------------------------------
+enum LabelingMethod{
+	LABEL_TWO_PASS,		// Pixel by pixel raster scan
+	LABEL_RUN_LENGTH,	// Label whole runs of foreground pixels
+	LABEL_BLOCK,		// Label blocks of pixels with a decision table
+	LABEL_PARALLEL,		// Label horizontal strips on their own threads
+	LABEL_MOMENTS		// Two pass, measuring objects for get_objects() too
+};
+
+// ---------------------------------------------------------------------------
+// Connectivity
+// Purpose: Which neighbours of a pixel belong to the same object: the 4
+//			sharing an edge, or all 8 around it.
+// ---------------------------------------------------------------------------
+enum Connectivity{
+	CONNECTIVITY_4 = 4,
+	CONNECTIVITY_8 = 8
+};
+
+// ---------------------------------------------------------------------------
+// MatchMethod
+// Purpose: How compare_to() pairs database entries with objects.
+// ---------------------------------------------------------------------------
+enum MatchMethod{
+	MATCH_AREA,		// Each entry takes the last object within 500 of its area
+	MATCH_NEAREST,	// Each object takes its nearest entry in a FeatureIndex
+	MATCH_SCAN,		// As MATCH_NEAREST, scoring every entry of a FeatureStore
+	MATCH_ASSIGN	// Objects and entries paired one to one, least summed
+					// squared feature distance, from a FeatureStore
+};
+
+// ---------------------------------------------------------------------------
+// Match
+// Purpose: Database entry found in a labeled image.
+// ---------------------------------------------------------------------------
+struct Match{
+	int label;			// Object in the image
+	int entry;			// Index of the record in the database
+	double distance;	// Area difference with MATCH_AREA, feature distance
+						// with MATCH_NEAREST, and the FeatureStore's weighted
+						// feature distance to the entry with MATCH_SCAN and
+						// MATCH_ASSIGN
+};
+
+// Feature distance within which MATCH_NEAREST pairs an object with an entry
+const double MATCH_TOLERANCE = 1.0;
 
 class LabeledImage : public Image{
 
@@ -24,14 +82,117 @@ public:
 	// Parameters:
 	//		Parameter 1: Image file path
 	//		Parameter 2: Convert this image?
+	//		Parameter 3: Labeling engine to convert with
+	//		Parameter 4: Pixel connectivity of objects
+	//		Parameter 5: Number objects in raster order with LABEL_PARALLEL?
+	//					 Otherwise numbers depend on thread timing
 	// ---------------------------------------------------------------------------
-	LabeledImage( const char*, bool );
+	LabeledImage( const char*, bool, const LabelingMethod = LABEL_TWO_PASS,
+				  const Connectivity = CONNECTIVITY_4, const bool = true );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Constructs a labeled image from a copy of an image in memory.
+	//
+	// Parameters:
+	//		Parameter 1: Image
+	//		Parameter 2: Convert this image?
+	//		Parameter 3: Labeling engine to convert with
+	//		Parameter 4: Pixel connectivity of objects
+	//		Parameter 5: Number objects in raster order with LABEL_PARALLEL?
+	// ---------------------------------------------------------------------------
+	LabeledImage( const Image&, bool, const LabelingMethod = LABEL_TWO_PASS,
+				  const Connectivity = CONNECTIVITY_4, const bool = true );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Constructs a labeled image from an image in memory, taking
+	//			over its pixels instead of copying them.
+	//
+	// Parameters:
+	//		Parameter 1: Image, left empty
+	//		Parameter 2: Convert this image?
+	//		Parameter 3: Labeling engine to convert with
+	//		Parameter 4: Pixel connectivity of objects
+	//		Parameter 5: Number objects in raster order with LABEL_PARALLEL?
+	// ---------------------------------------------------------------------------
+	LabeledImage( Image&&, bool, const LabelingMethod = LABEL_TWO_PASS,
+				  const Connectivity = CONNECTIVITY_4, const bool = true );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Constructs a labeled image from a packed binary image, labeling
+	//			it without unpacking.
+	//
+	// Parameters:
+	//		Parameter 1: Packed binary image
+	//		Parameter 2: Labeling engine to convert with
+	//		Parameter 3: Pixel connectivity of objects
+	//		Parameter 4: Number objects in raster order with LABEL_PARALLEL?
+	//					 Otherwise numbers depend on thread timing
+	// ---------------------------------------------------------------------------
+	LabeledImage( const PackedBinaryImage&, const LabelingMethod = LABEL_TWO_PASS,
+				  const Connectivity = CONNECTIVITY_4, const bool = true );
 
 	~LabeledImage( void );
+
+	// ---------------------------------------------------------------------------
+	// Get_Label
+	// Purpose: Object number of pixel ( i, j ), 0 for background. Converted
+	//			images keep every object number whole in a label plane, the
+	//			pixels only being a rendering of it (see get_grey_level);
+	//			otherwise the grey levels are the labels.
+	//
+	// Returns: Object number, or -1 if out of the image
+	// ---------------------------------------------------------------------------
+	int get_label( const int i, const int j ) const{
+		if( label_plane.empty() || i < 0 || i >= getNRows() || j < 0 || j >= getNCols() )
+			return label_plane.empty() ? getPixel( i, j ) : -1;
+		return label_plane[ (size_t)i * getNCols() + j ];
+	}
+
+	// ---------------------------------------------------------------------------
+	// Get_Label_Row
+	// Purpose: Object numbers of row i, getNCols() of them, or null if the
+	//			image wasn't converted.
+	// ---------------------------------------------------------------------------
+	const int* get_label_row( const int i ) const{
+		return label_plane.empty() ? 0 : &label_plane[ (size_t)i * getNCols() ];
+	}
+
+	// ---------------------------------------------------------------------------
+	// Get_Object_Count
+	// Purpose: Number of objects found converting the image, 0 if it wasn't
+	//			converted.
+	// ---------------------------------------------------------------------------
+	int get_object_count( void ) const{ return object_count; }
+
+	// ---------------------------------------------------------------------------
+	// Get_Grey_Level
+	// Purpose: Grey level an object is drawn with. Numbers past 255 wrap
+	//			around 1 ... 255, so no object is drawn as background, but
+	//			then grey levels are shared: read objects through get_label,
+	//			not from the pixels.
+	// ---------------------------------------------------------------------------
+	static unsigned char get_grey_level( const int object ){
+		return object ? (unsigned char)( 1 + ( object - 1 ) % 255 ) : 0;
+	}
 	
+	// ---------------------------------------------------------------------------
+	// Get_Object_Table
+	// Purpose: Area and moments of every object of the image, keyed by
+	//			object number. Objects measured while labeling with
+	//			LABEL_MOMENTS are returned without scanning the image again.
+	//			Otherwise the label plane, or the grey levels of an image
+	//			that wasn't converted, are scanned a band of rows per
+	//			thread. Lines drawn on the image don't change its objects.
+	// ---------------------------------------------------------------------------
+	ObjectTable get_object_table( void ) const;
+
 	// ---------------------------------------------------------------------------
 	// Get_Objects
-	// Purpose: Gets all the unique objects from the image.
+	// Purpose: Gets all the unique objects from the image, keyed by object
+	//			number. Same objects as get_object_table().
 	// ---------------------------------------------------------------------------
 	std::map< int, ObjectInfo > get_objects( void ) const;
 
@@ -40,22 +201,73 @@ public:
 	// Purpose: Calculate the row center, column center, minimum inertia, and 
 	//			orientation. Write the information to a database text 
 	//			file, and creates a line from ( row center, column center )
-	//			to the direction of the orientation on this image.
+	//			to the direction of the orientation on this image. Each line
+	//			holds label, row center, column center, minimum inertia,
+	//			orientation, area, min row, min column, max row, max column,
+	//			perimeter and the 7 Hu invariants.
 	// Parameters:
 	// 		1: output path
+	//		2: Write the database as text or binary, see ObjectDatabase
+	//		3: Add the objects to the database already there instead,
+	//		   skipping near duplicates, see ObjectDatabase::append
+	//
+	// Throws: std::runtime_error if appending to a damaged binary database
 	// ---------------------------------------------------------------------------
-	void process_data( const char* output_file );
+	void process_data( const char* output_file, const DatabaseFormat = DB_TEXT, const bool append = false );
 
 	// ---------------------------------------------------------------------------
 	// Compare_To
 	// Purpose: Compares this image to a database filled with the following values:
 	//			label, center_x, center_y, minimum inertia, orientation separated
 	//			by a space, in a line by line format. Each line represents a
-	//			unique object.
+	//			unique object. Entries with the descriptors process_data()
+	//			writes after the area only match objects of similar
+	//			perimeter and shape. Binary databases are mapped and read
+	//			in place.
 	// Parameters:
 	// 		1: database path
+	//		2: How to pair entries with objects
+	//
+	// Returns: The matches drawn
+	// ---------------------------------------------------------------------------
+	std::vector< Match > compare_to( const char* database, const MatchMethod = MATCH_AREA );
+
+	// ---------------------------------------------------------------------------
+	// Compare_To
+	// Purpose: As above, against a database already loaded.
+	// ---------------------------------------------------------------------------
+	std::vector< Match > compare_to( const ObjectDatabase&, const MatchMethod = MATCH_AREA );
+
+	// ---------------------------------------------------------------------------
+	// Compare_To
+	// Purpose: Matches each object to its nearest database entry in feature
+	//			space, if one is within the tolerance, and marks the objects
+	//			matched. The index is built once and reused for every image.
+	// Parameters:
+	// 		1: Index of the database
+	//		2: Farthest feature distance of a match
+	//
+	// Returns: The matches drawn
+	// ---------------------------------------------------------------------------
+	std::vector< Match > compare_to( const FeatureIndex&, const double tolerance = MATCH_TOLERANCE );
+
 	// ---------------------------------------------------------------------------
-	void compare_to( const char* database );
+	// Compare_To
+	// Purpose: As above, scoring every entry of the store against each
+	//			object, objects split over threads. No index to build, so
+	//			suits databases loaded for a single image. One to one, no
+	//			two objects match the same entry: objects and the entries
+	//			within the tolerance of them are paired for the least summed
+	//			squared distance, leaving unpaired those only matching far.
+	// Parameters:
+	// 		1: Features of the database
+	//		2: Farthest feature distance of a match
+	//		3: Match one to one?
+	//
+	// Returns: The matches drawn
+	// ---------------------------------------------------------------------------
+	std::vector< Match > compare_to( const FeatureStore&, const double tolerance = MATCH_TOLERANCE,
+									 const bool one_to_one = false );
 	
 	// ---------------------------------------------------------------------------
 	// Draw_Orientation
@@ -66,13 +278,108 @@ public:
 	// ---------------------------------------------------------------------------
 	void draw_orientation( const double angle );
 
+	// ---------------------------------------------------------------------------
+	// Get_Runs
+	// Purpose: Runs of each object, labeled with the object's number, when the
+	//			image was converted with LABEL_RUN_LENGTH. Empty otherwise.
+	// ---------------------------------------------------------------------------
+	const RunLengthImage& get_runs( void ) const{ return runs; }
+
 private:
 
+	// Runs of each object, see get_runs()
+	RunLengthImage runs;
+
+	// Object number of every pixel, rows x columns, 0 for background. Empty
+	// if the image wasn't converted, see get_label()
+	std::vector< int > label_plane;
+
+	// Number of objects found converting the image
+	int object_count;
+
+	// Area and moments of each object by object number, index 0 unused.
+	// Only filled by LABEL_MOMENTS, see get_objects()
+	std::vector< ObjectInfo > measured_objects;
+
+	// ---------------------------------------------------------------------------
+	// Label
+	// Purpose: Labels this binary image, or a packed binary image into this
+	//			all background image, with the engine given. Engines are
+	//			specialized on connectivity C (4 or 8), so their inner loops
+	//			never branch on it.
+	// ---------------------------------------------------------------------------
+	template< int C > void label( const LabelingMethod, const bool );
+	template< int C > void label( const PackedBinaryImage&, const LabelingMethod, const bool );
+
+	// ---------------------------------------------------------------------------
+	// Run_Length
+	// Purpose: Labels objects by runs of foreground pixels. Runs of a row are
+	//			merged with the runs they overlap in the row above, so union-find
+	//			work is per run instead of per pixel, and each run is written
+	//			out with one fill.
+	//
+	// Parameters:
+	//		1: Runs of the binary image, labeled in place
+	// ---------------------------------------------------------------------------
+	template< int C > void run_length( RunLengthImage& );
+
+	// ---------------------------------------------------------------------------
+	// Block_Based
+	// Purpose: Labels objects a block of pixels at a time (2x2 blocks for 8
+	//			way connectivity, 2x1 for 4 way). A table built once picks
+	//			which neighbour blocks each block takes its label from, so
+	//			most pixels are read once and neighbours already known to be
+	//			connected are never merged again.
+	// ---------------------------------------------------------------------------
+	template< int C > void block_based( void );
+
+	// ---------------------------------------------------------------------------
+	// Strip_Parallel
+	// Purpose: Labels objects by runs, each horizontal strip of the image on
+	//			its own thread, then merges labels across strip boundaries and
+	//			writes the strips out in parallel.
+	//
+	// Parameters:
+	//		1: Binary image, this image or a packed one
+	//		2: Number objects in raster order?
+	// ---------------------------------------------------------------------------
+	template< int C, typename Source > void strip_parallel( const Source&, const bool );
+
 	// ---------------------------------------------------------------------------
 	// Two_Pass
 	// Purpose: Labels objects in a binary image with varying grey levels. 
+	//			With Moments, objects are measured in the first pass too.
+	// ---------------------------------------------------------------------------
+	template< int C, bool Moments > void two_pass( void );
+
+	// ---------------------------------------------------------------------------
+	// Two_Pass
+	// Purpose: Labels objects in a packed binary image, skipping background
+	//			words.
+	// ---------------------------------------------------------------------------
+	template< int C, bool Moments > void two_pass( const PackedBinaryImage& );
+
+	// ---------------------------------------------------------------------------
+	// Resolve_Labels
+	// Purpose: Second pass of the labeling. Replaces every provisional label
+	//			with the number of its object, which becomes the label plane,
+	//			and draws the objects.
+	//
+	// Parameters:
+	//		1: Provisional labels from the first pass, 0 for background.
+	//		   Taken over as the label plane
+	//		2: Label equivalences from the first pass, one set per label
+	//		3: Area and moments of each provisional label, or null
+	// ---------------------------------------------------------------------------
+	void resolve_labels( std::vector< int >&, DisjSets&,
+						 const std::vector< ObjectInfo >* = 0 );
+
+	// ---------------------------------------------------------------------------
+	// Finish_Labels
+	// Purpose: Records the number of objects found, and the grey levels used
+	//			drawing them.
 	// ---------------------------------------------------------------------------
-	void two_pass( void );
+	void finish_labels( const int total_objects );
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+// ---------------------------------------------------------------------------
+// MatchBatch.h
+// Matches many labeled images against one object database. The database,
+// and its index or feature store, are loaded and built once and shared by
+// a pool of worker threads, each matching a whole image at a time.
+// ---------------------------------------------------------------------------
+
+#ifndef _MATCHBATCH_
+#define _MATCHBATCH_
+
+#include "LabeledImage.h"
+#include "ObjectDatabase.h"
+#include "FeatureIndex.h"
+#include "FeatureStore.h"
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// ImageMatches
+// Purpose: Outcome of matching one image of a batch.
+// ---------------------------------------------------------------------------
+struct ImageMatches{
+	std::string image;				// Input path
+	std::string output;				// Output path, empty if not written
+	bool ok;						// False if the image couldn't be read or written
+	std::vector< Match > matches;
+};
+
+class MatchBatch{
+
+public:
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Builds what the match method needs from the database: a
+	//			FeatureIndex for MATCH_NEAREST, a FeatureStore for MATCH_SCAN
+	//			and MATCH_ASSIGN. The database must outlive the batch.
+	//
+	// Parameters:
+	//		Parameter 1: Database
+	//		Parameter 2: How to pair entries with objects
+	// ---------------------------------------------------------------------------
+	MatchBatch( const ObjectDatabase&, const MatchMethod = MATCH_AREA );
+
+	~MatchBatch( void );
+
+	// ---------------------------------------------------------------------------
+	// Compare
+	// Purpose: Matches one labeled image, marking the matches on it. Safe to
+	//			call from several threads at once on different images.
+	//
+	// Returns: The matches drawn
+	// ---------------------------------------------------------------------------
+	std::vector< Match > compare( LabeledImage& ) const;
+
+	// ---------------------------------------------------------------------------
+	// Run
+	// Purpose: Reads, matches and writes every image, a worker thread taking
+	//			the next image as soon as it's done with one.
+	//
+	// Parameters:
+	//		1: Input image paths
+	//		2: Output image paths, one per input, or empty not to write any
+	//		3: Label binary inputs, measuring objects while labeling?
+	//		4: Number of workers, 0 for one per hardware thread
+	//
+	// Returns: Matches of each image, in input order
+	// ---------------------------------------------------------------------------
+	std::vector< ImageMatches > run( const std::vector< std::string >& images,
+									 const std::vector< std::string >& outputs,
+									 const bool binary, const int workers = 0 ) const;
+
+	// ---------------------------------------------------------------------------
+	// Write_Results
+	// Purpose: Writes the matches of a batch to one text file, a line per
+	//			match: image, object label, database entry, database label
+	//			and distance. Images that failed get a line "image failed".
+	//
+	// Returns: 0 if OK or -1 if the file can't be written
+	// ---------------------------------------------------------------------------
+	int write_results( const char* path, const std::vector< ImageMatches >& ) const;
+
+	// ---------------------------------------------------------------------------
+	// List_Images
+	// Purpose: Paths of a batch: the .pgm files of a directory, sorted by
+	//			name, or the lines of a list file, blank lines skipped.
+	//
+	// Parameters:
+	//		1: Directory or list file
+	//
+	// Returns: Image paths, empty if the path can't be read
+	// ---------------------------------------------------------------------------
+	static std::vector< std::string > list_images( const char* );
+
+private:
+
+	const ObjectDatabase& database;
+	const MatchMethod method;
+
+	// Built once for the methods that need them, 0 otherwise
+	FeatureIndex* index;
+	FeatureStore* store;
+
+	// Not copyable, the index and store have one owner
+	MatchBatch( const MatchBatch& );
+	MatchBatch& operator=( const MatchBatch& );
+};
+
+#endif
@@ -0,0 +1,217 @@
+// ---------------------------------------------------------------------------
+// MatchServer.h
+// Long running matcher: keeps an object database and its index resident
+// and matches frames sent by local producers over a Unix domain socket,
+// reloading the database whenever its file changes. Also the client side
+// of the protocol.
+// ---------------------------------------------------------------------------
+
+#ifndef _MATCHSERVER_
+#define _MATCHSERVER_
+
+#include "Image.h"
+#include "LabeledImage.h"
+#include "ObjectDatabase.h"
+#include "MatchBatch.h"
+#include <stdint.h>
+#include <sys/types.h>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Protocol
+// Purpose: A client sends a FrameHeader followed by rows * cols pixels, row
+//			after row, and gets back a ReplyHeader followed by count
+//			ReplyMatches. Any number of frames may be sent on a connection.
+//			Fields are in native byte order, the socket being local.
+// ---------------------------------------------------------------------------
+const char FRAME_MAGIC[ 4 ] = { 'F', 'R', 'M', '1' };
+const char REPLY_MAGIC[ 4 ] = { 'M', 'C', 'H', '1' };
+
+// Frame flags
+enum{
+	FRAME_BINARY = 1	// Binary frame to label first, otherwise already labeled
+};
+
+// Largest frame accepted by default, in pixels: 8K UHD fits
+const int64_t FRAME_MAX_PIXELS = (int64_t)1 << 26;
+
+// Connections served at once by default, more wait to be accepted
+const int MAX_CONNECTIONS = 16;
+
+struct FrameHeader{
+	char magic[ 4 ];	// FRAME_MAGIC
+	int32_t rows;
+	int32_t cols;
+	int32_t flags;
+};
+
+struct ReplyHeader{
+	char magic[ 4 ];	// REPLY_MAGIC
+	int32_t status;		// 0 if matched, -1 if the frame was rejected
+	int32_t count;		// Number of ReplyMatches following
+	int32_t reserved;
+};
+
+struct ReplyMatch{
+	int32_t label;		// Object in the frame
+	int32_t entry;		// Index of the record in the database
+	int32_t db_label;	// Label of the record
+	int32_t reserved;
+	double distance;	// As Match::distance
+};
+
+class MatchServer{
+
+public:
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Loads the database and builds what the match method needs.
+	//			A frame is held while it's served: a byte per pixel, plus
+	//			4 bytes of labels per pixel for a binary frame, and the
+	//			measurements of its objects. The two limits bound the pixels
+	//			to about 5 * max_pixels * max_connections bytes at once.
+	//
+	// Parameters:
+	//		Parameter 1: Database path
+	//		Parameter 2: How to pair entries with objects
+	//		Parameter 3: Largest frame accepted, in pixels
+	//		Parameter 4: Most connections served at once
+	//
+	// Throws: std::runtime_error if a binary database is damaged
+	// ---------------------------------------------------------------------------
+	MatchServer( const char*, const MatchMethod = MATCH_NEAREST,
+				 const int64_t max_pixels = FRAME_MAX_PIXELS, const int max_connections = MAX_CONNECTIONS );
+
+	// ---------------------------------------------------------------------------
+	// Serve
+	// Purpose: Listens on a Unix domain socket, replacing any socket file
+	//			left at the path, and serves each connection on its own
+	//			thread, up to the most connections given. The database file
+	//			is checked for changes every second and reloaded. Only
+	//			returns on failure, once every thread it started is done.
+	//
+	// Parameters:
+	//		1: Socket path
+	//
+	// Returns: -1 if the socket can't be set up or accepting fails
+	// ---------------------------------------------------------------------------
+	int serve( const char* socket_path );
+
+	// ---------------------------------------------------------------------------
+	// Reload_If_Changed
+	// Purpose: Reloads the database if its file was replaced or modified.
+	//			Frames in flight finish with the database they started with.
+	//			A database that fails to load is skipped, keeping the old one.
+	//
+	// Returns: True if a new database was loaded
+	// ---------------------------------------------------------------------------
+	bool reload_if_changed( void );
+
+	// ---------------------------------------------------------------------------
+	// Match_Frame
+	// Purpose: Matches one frame against the resident database, taking over
+	//			its pixels.
+	//
+	// Parameters:
+	//		1: Frame
+	//		2: Binary frame to label first?
+	//		3: Out: Matches
+	// ---------------------------------------------------------------------------
+	void match_frame( Image&&, const bool binary, std::vector< ReplyMatch >& );
+
+private:
+
+	// ---------------------------------------------------------------------------
+	// Resident
+	// Purpose: A loaded database and its index, replaced whole on reload.
+	// ---------------------------------------------------------------------------
+	struct Resident{
+		ObjectDatabase database;
+		MatchBatch batch;
+		Resident( const char* path, const MatchMethod method ) : database( path ), batch( database, method ){ }
+	};
+
+	// File identity of a loaded database
+	struct Version{
+		dev_t device;
+		ino_t inode;
+		off_t size;
+		time_t modified;
+		long modified_ns;
+		bool operator==( const Version& ) const;
+	};
+
+	// ---------------------------------------------------------------------------
+	// Connection
+	// Purpose: A connection being served, and the thread serving it. The
+	//			accepting thread joins the thread and closes the socket once
+	//			done is set.
+	// ---------------------------------------------------------------------------
+	struct Connection{
+		int socket;
+		std::thread thread;
+		bool done;
+	};
+
+	const std::string path;
+	const MatchMethod method;
+	const int64_t frame_max_pixels;
+	const int connection_limit;
+
+	std::mutex lock;	// Guards resident and version
+	std::shared_ptr< const Resident > resident;
+	Version version;
+
+	std::mutex connections_lock;	// Guards connections, their done flags and stopping
+	std::condition_variable connection_done;
+	std::list< Connection > connections;
+
+	// Set when serve() gives up, for the threads it started to finish
+	bool stopping;
+	std::condition_variable stop_requested;
+
+	static Version file_version( const char* );
+	std::shared_ptr< const Resident > current( void );
+	void handle( Connection* );
+	void reap_connections( std::unique_lock< std::mutex >& );
+	void watch( void );
+	void stop_serving( std::thread& watcher );
+
+	// Not copyable
+	MatchServer( const MatchServer& );
+	MatchServer& operator=( const MatchServer& );
+};
+
+// ---------------------------------------------------------------------------
+// Connect_Matcher
+// Purpose: Connects to a match server.
+//
+// Parameters:
+//		1: Socket path
+//
+// Returns: Connection descriptor, or -1 if it can't connect
+// ---------------------------------------------------------------------------
+int connect_matcher( const char* socket_path );
+
+// ---------------------------------------------------------------------------
+// Send_Frame
+// Purpose: Sends a frame on a connection and waits for its matches.
+//
+// Parameters:
+//		1: Connection from connect_matcher()
+//		2: Frame
+//		3: Binary frame for the server to label?
+//		4: Out: Matches
+//
+// Returns: 0 if OK, -1 if the connection failed or the frame was rejected
+// ---------------------------------------------------------------------------
+int send_frame( const int connection, const Image&, const bool binary, std::vector< ReplyMatch >& );
+
+#endif
@@ -0,0 +1,180 @@
+// ---------------------------------------------------------------------------
+// ObjectDatabase.h
+// Database of objects to match labeled images against, one record per
+// object. Stored either as text, one line per object, or as a binary file
+// of fixed size records that is mapped into memory as is.
+// ---------------------------------------------------------------------------
+
+#ifndef _OBJECTDATABASE_
+#define _OBJECTDATABASE_
+
+#include "ObjectInfo.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// DatabaseFormat
+// Purpose: How a database is stored.
+// ---------------------------------------------------------------------------
+enum DatabaseFormat{
+	DB_TEXT,	// One line per object: label, row center, column center,
+				// minimum inertia, orientation, area, and optionally min row,
+				// min column, max row, max column, perimeter and 7 Hu
+				// invariants, separated by spaces
+	DB_BINARY	// DatabaseHeader, then count ObjectRecords
+};
+
+// Record flags
+enum{
+	RECORD_HAS_DESCRIPTORS = 1	// Bounding box, perimeter and Hu invariants are set
+};
+
+// ---------------------------------------------------------------------------
+// ObjectRecord
+// Purpose: One object of a database. 128 bytes, so records stay 64 byte
+//			aligned in a mapped file.
+// ---------------------------------------------------------------------------
+struct ObjectRecord{
+	int32_t label;
+	int32_t flags;
+	int32_t min_row;
+	int32_t min_col;
+	int32_t max_row;
+	int32_t max_col;
+	int64_t area;
+	int64_t perimeter;
+	double row_center;
+	double col_center;
+	double min_inertia;
+	double orientation;	// RADIANS
+	double hu[ 7 ];
+};
+
+// ---------------------------------------------------------------------------
+// DatabaseHeader
+// Purpose: Start of a binary database. Records are in native byte order.
+// ---------------------------------------------------------------------------
+struct DatabaseHeader{
+	char magic[ 8 ];		// DATABASE_MAGIC
+	uint32_t version;		// DATABASE_VERSION
+	uint32_t record_size;	// sizeof( ObjectRecord )
+	uint64_t count;			// Number of records
+	char reserved[ 40 ];
+};
+
+const char DATABASE_MAGIC[ 8 ] = { 'O', 'B', 'J', 'E', 'C', 'T', 'D', 'B' };
+const uint32_t DATABASE_VERSION = 1;
+
+// Feature distance, as FeatureIndex measures it, within which an appended
+// record is taken for one already in the database
+const double DUPLICATE_TOLERANCE = 0.1;
+
+class ObjectDatabase{
+
+public:
+
+	ObjectDatabase( void );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Loads a database. Binary databases, told apart by their magic
+	//			number, are mapped read only and used in place; text ones
+	//			are parsed. A file that can't be opened gives an empty
+	//			database, as before.
+	//
+	// Parameters:
+	//		Parameter 1: Database path
+	//
+	// Throws: std::runtime_error if a binary database is damaged
+	// ---------------------------------------------------------------------------
+	explicit ObjectDatabase( const char* );
+
+	~ObjectDatabase( void );
+
+	// ---------------------------------------------------------------------------
+	// Make_Record
+	// Purpose: Record of an object, with every descriptor set.
+	//
+	// Parameters:
+	//		1: Label
+	//		2: Object
+	// ---------------------------------------------------------------------------
+	static ObjectRecord make_record( const int label, const ObjectInfo& );
+
+	// ---------------------------------------------------------------------------
+	// Add
+	// Purpose: Appends a record. A mapped database is copied into memory
+	//			first.
+	// ---------------------------------------------------------------------------
+	void add( const ObjectRecord& );
+
+	// ---------------------------------------------------------------------------
+	// Write
+	// Purpose: Writes the database to a file. The file is replaced whole,
+	//			by renaming, so it can be written while being read or mapped,
+	//			and waits for an append to it to finish. Writers take turns
+	//			through a lock on a "<path>.lock" file left beside it.
+	//
+	// Parameters:
+	//		1: Path
+	//		2: Format
+	//
+	// Returns: 0 if OK or -1 if the file can't be written
+	// ---------------------------------------------------------------------------
+	int write( const char*, const DatabaseFormat ) const;
+
+	// ---------------------------------------------------------------------------
+	// Append
+	// Purpose: Adds the records of this database to the end of a database
+	//			file, leaving the records already there untouched: a binary
+	//			file gets the new records after its last one, then its count
+	//			updated, a text file gets new lines. Records near one already
+	//			in the file, or one added before them, are skipped; records
+	//			without descriptors are always added. Appends to a file take
+	//			turns, with each other and with write(), so several processes
+	//			can build one database at once.
+	//
+	// Parameters:
+	//		1: Path, created if there's no file
+	//		2: Format of a new file, otherwise the file keeps its own
+	//		3: Feature distance of a duplicate, 0 to add every record
+	//
+	// Returns: Number of records added, or -1 if the file can't be written
+	//
+	// Throws: std::runtime_error if the file is a damaged binary database
+	// ---------------------------------------------------------------------------
+	int append( const char*, const DatabaseFormat, const double tolerance = DUPLICATE_TOLERANCE ) const;
+
+	// Format the database was loaded from, text if it was built in memory
+	DatabaseFormat getFormat( void ) const{ return format; }
+
+	size_t size( void ) const{ return count; }
+	const ObjectRecord& operator[]( const size_t i ) const{ return records[ i ]; }
+	const ObjectRecord* begin( void ) const{ return records; }
+	const ObjectRecord* end( void ) const{ return records + count; }
+
+private:
+
+	// Records, either owned or inside mapping
+	const ObjectRecord* records;
+	size_t count;
+	std::vector< ObjectRecord > owned;
+
+	// Mapped file, 0 if none
+	void* mapping;
+	size_t mapping_length;
+
+	DatabaseFormat format;
+
+	void parse_text( const char* text, const size_t length );
+	int write_file( const int fd, const DatabaseFormat ) const;
+	int append_locked( const int fd, const char* path, const DatabaseFormat, const double tolerance ) const;
+	void unmap( void );
+
+	// Not copyable, a mapping has one owner
+	ObjectDatabase( const ObjectDatabase& );
+	ObjectDatabase& operator=( const ObjectDatabase& );
+};
+
+#endif
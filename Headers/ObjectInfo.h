@@ -9,9 +9,56 @@
 #ifndef _OBJECTINFO_
 #define _OBJECTINFO_
 
+// ---------------------------------------------------------------------------
+// ObjectFeatures
+// Purpose: Features derived from an object's area and moments.
+// ---------------------------------------------------------------------------
+struct ObjectFeatures{
+
+  // Center, and orientation and minimum inertia about it, as written to
+  // databases: the center is rounded down to whole rows and columns
+  double row_center;   // EEi / area, whole rows
+  double col_center;   // EEj / area, whole columns
+  double orientation;  // RADIANS
+  double min_inertia;  // See calculateMinInertia
+
+  // Second moments about the exact centroid: a = sum of squared row
+  // offsets, b = twice the sum of row offset x column offset, c = sum of
+  // squared column offsets
+  double a;
+  double b;
+  double c;
+
+  double principal_min_inertia; // ( a + c - sqrt( b^2 + ( a - c )^2 ) ) / 2
+  double principal_max_inertia; // ( a + c + sqrt( b^2 + ( a - c )^2 ) ) / 2
+  double elongation;   // principal max / principal min, infinite for lines
+
+  // Hu's seven moment invariants, unchanged by translation, scale and
+  // rotation ( hu[ 6 ] changes sign under reflection )
+  double hu[ 7 ];
+};
+
 class ObjectInfo{
 
 public:
+
+  // ---------------------------------------------------------------------------
+  // CONSTRUCTOR
+  // Purpose: Object with no pixels.
+  // ---------------------------------------------------------------------------
+  ObjectInfo( void );
+
+  // ---------------------------------------------------------------------------
+  // GetFeatures
+  // Purpose: Features of the object, worked out on first use and kept until
+  //          the area or moments change through a setter, addPixel or add.
+  // Returns: Feature record
+  // ---------------------------------------------------------------------------
+  const ObjectFeatures& getFeatures( void ) const{
+    if( !features_valid )
+      calculateFeatures();
+    return features;
+  }
 	
   // ---------------------------------------------------------------------------
   // CalculateRowCenter
@@ -19,7 +66,7 @@ public:
   //
   // Returns: Value of EEi/area, or -1 if invalid values
   // ---------------------------------------------------------------------------
-  double calculateRowCenter( void );
+  double calculateRowCenter( void ) const;
   
   // ---------------------------------------------------------------------------
   // CalculateColCenter
@@ -27,7 +74,7 @@ public:
   //
   // Returns: Value of EEj/area, or -1 if invalid values
   // ---------------------------------------------------------------------------
-  double calculateColCenter( void );
+  double calculateColCenter( void ) const;
   
   // ---------------------------------------------------------------------------
   // CalculateMinInertia
@@ -35,7 +82,7 @@ public:
   // 			center, EEi2, and EEj2.
   // Returns: Value from minimum interia calculation
   // ---------------------------------------------------------------------------
-  double calculateMinInertia( void );
+  double calculateMinInertia( void ) const;
   
   // ---------------------------------------------------------------------------
   // CalculateOrientation
@@ -43,45 +90,120 @@ public:
   // 			and an angle.
   // Returns: Value from orientation calculation
   // ---------------------------------------------------------------------------
-  double calculateOrientation( void );
+  double calculateOrientation( void ) const;
 
   // ---------------------------------------------------------------------------
   // GETTER FUNCTIONS
   // Purpose: Encapsulate class objects to facilitate proper OOP.
   // Returns: Respective values
   // ---------------------------------------------------------------------------
-  int getArea( void ) const;
-  int getEEi( void ) const;
-  int getEEj( void ) const;
-  int getEEi2( void ) const;
-  int getEEj2( void ) const;
-  int getEEij( void ) const;
+  long long getArea( void ) const;
+  long long getEEi( void ) const;
+  long long getEEj( void ) const;
+  long long getEEi2( void ) const;
+  long long getEEj2( void ) const;
+  long long getEEij( void ) const;
+  long long getPerimeter( void ) const;
+  int getMinRow( void ) const;
+  int getMinCol( void ) const;
+  int getMaxRow( void ) const;
+  int getMaxCol( void ) const;
   
   // ---------------------------------------------------------------------------
   // SETTER FUNCTIONS
   // Purpose: Encapsulate class objects to facilitate proper OOP.
   // Returns: Respective values
   // ---------------------------------------------------------------------------
-  void setArea( const int );
-  void setEEi( const int );
-  void setEEj( const int );
-  void setEEi2( const int );
-  void setEEj2( const int );
-  void setEEij( const int );
+  void setArea( const long long );
+  void setEEi( const long long );
+  void setEEj( const long long );
+  void setEEi2( const long long );
+  void setEEj2( const long long );
+  void setEEij( const long long );
 
   // ---------------------------------------------------------------------------
-  // Data Variables
-  // Purpose: Store respective object values.
-  // ---------------------------------------------------------------------------
-  int area;
-  int eei;
-  int eej;
-  int eei2;
-  int eej2;
-  int eeij;
-  
+  // AddPixel
+  // Purpose: Accumulates pixel ( i, j ) into the area, moments, bounding box
+  //          and perimeter. Inline, as labeling calls it once per foreground
+  //          pixel.
+  //
+  // Parameters:
+  //    1: Row
+  //    2: Column
+  //    3: Number of the pixel's 4 neighbours outside the object
+  // ---------------------------------------------------------------------------
+  void addPixel( const int i, const int j, const int edges ){
+    features_valid = false;
+    area++;
+    eei += i;
+    eej += j;
+    eei2 += ( (long long)i * i );
+    eej2 += ( (long long)j * j );
+    eeij += ( (long long)i * j );
+
+    const double di = i, dj = j;
+    eei3 += di * di * di;
+    eej3 += dj * dj * dj;
+    eei2j += di * di * dj;
+    eeij2 += di * dj * dj;
+
+    perimeter += edges;
+    if( i < min_row ) min_row = i;
+    if( i > max_row ) max_row = i;
+    if( j < min_col ) min_col = j;
+    if( j > max_col ) max_col = j;
+  }
+
+  // ---------------------------------------------------------------------------
+  // Add
+  // Purpose: Accumulates the area and moments of another part of the object.
+  // ---------------------------------------------------------------------------
+  void add( const ObjectInfo& );
+
 private:
 
+  friend class ObjectTable;
+
+  // ---------------------------------------------------------------------------
+  // Data Variables
+  // Purpose: Store respective object values. 64 bit, as second moments of
+  //          large objects in large images overflow 32 bits. Private, so
+  //          they only change through the setters, addPixel or add, which
+  //          drop cached features. ObjectTable reads and fills them in bulk.
+  // ---------------------------------------------------------------------------
+  long long area;
+  long long eei;
+  long long eej;
+  long long eei2;
+  long long eej2;
+  long long eeij;
+
+  // Third order moments, in doubles as they overflow 64 bit integers in
+  // large images
+  double eei3;
+  double eej3;
+  double eei2j;
+  double eeij2;
+
+  // Pixel edges between the object and the pixels around it
+  long long perimeter;
+
+  // Bounding box, inclusive. Empty objects have min > max
+  int min_row;
+  int min_col;
+  int max_row;
+  int max_col;
+
+  // Features, valid if features_valid
+  mutable ObjectFeatures features;
+  mutable bool features_valid;
+
+  // ---------------------------------------------------------------------------
+  // CalculateFeatures
+  // Purpose: Works out the feature record from the area and moments.
+  // ---------------------------------------------------------------------------
+  void calculateFeatures( void ) const;
+
   // ---------------------------------------------------------------------------
   // E
   // Purpose: Inertia Mass calculator. Acts as a helper function for the method
@@ -0,0 +1,154 @@
+// ---------------------------------------------------------------------------
+// ObjectTable.h
+// Area and moments of every object of a labeled image, one array per
+// quantity indexed by label.
+// ---------------------------------------------------------------------------
+
+#ifndef _OBJECTTABLE_
+#define _OBJECTTABLE_
+
+#include "Image.h"
+#include "ObjectInfo.h"
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+class ObjectTable{
+
+public:
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Empty table for labels [0, labels).
+	//
+	// Parameters:
+	//		Parameter 1: Number of labels
+	// ---------------------------------------------------------------------------
+	explicit ObjectTable( const int labels = 0 );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Measures every grey level of a labeled image but 0, each band
+	//			of rows into its own table on its own thread, then sums the
+	//			band tables. Objects are measured a run of equal grey level
+	//			at a time. Pixel edges to differing 4 neighbours, and to the
+	//			outside of the image, count towards the perimeter.
+	//
+	// Parameters:
+	//		Parameter 1: Labeled image
+	// ---------------------------------------------------------------------------
+	explicit ObjectTable( const Image& );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: As above, measuring every label of a label plane but 0.
+	//
+	// Parameters:
+	//		Parameter 1: Labels, rows x columns, one row after another
+	//		Parameter 2: Number of rows
+	//		Parameter 3: Number of columns
+	//		Parameter 4: Number of labels, every label is below it
+	// ---------------------------------------------------------------------------
+	ObjectTable( const int* labels, const int rows, const int cols, const int label_count );
+
+	// Number of labels, objects are labels with a non-zero area
+	int size( void ) const{ return (int)area.size(); }
+
+	// ---------------------------------------------------------------------------
+	// Add_Run
+	// Purpose: Accumulates pixels ( i, start ) ... ( i, end - 1 ) into the
+	//			object with the label, summing each moment over the run in
+	//			closed form rather than pixel by pixel.
+	//
+	// Parameters:
+	//		1: Label
+	//		2: Row
+	//		3: First column
+	//		4: End column
+	//		5: Pixel edges of the run to pixels outside the object
+	// ---------------------------------------------------------------------------
+	void add_run( const int label, const int i, const int start, const int end, const int edges ){
+
+		const int64_t n = end - start;
+		const int64_t first = start - 1, last = end - 1;
+
+		// Sums of j, j^2 and j^3 over [start, end), as differences of sums
+		// over [0, last] and [0, first]
+		const int64_t sum_j = n * ( start + last ) / 2;
+		const int64_t sum_j2 = last * ( last + 1 ) * ( 2 * last + 1 ) / 6
+							 - first * ( first + 1 ) * ( 2 * first + 1 ) / 6;
+		const double t_last = (double)last * ( last + 1 ) / 2;
+		const double t_first = (double)first * ( first + 1 ) / 2;
+		const double sum_j3 = t_last * t_last - t_first * t_first;
+
+		const int64_t i1 = i, i2 = i1 * i;
+		const double di = i;
+
+		area[ label ] += n;
+		eei[ label ] += i1 * n;
+		eej[ label ] += sum_j;
+		eei2[ label ] += i2 * n;
+		eej2[ label ] += sum_j2;
+		eeij[ label ] += i1 * sum_j;
+
+		eei3[ label ] += di * di * di * n;
+		eej3[ label ] += sum_j3;
+		eei2j[ label ] += di * di * sum_j;
+		eeij2[ label ] += di * sum_j2;
+
+		perimeter[ label ] += edges;
+		if( i < min_row[ label ] ) min_row[ label ] = i;
+		if( i > max_row[ label ] ) max_row[ label ] = i;
+		if( start < min_col[ label ] ) min_col[ label ] = start;
+		if( last > max_col[ label ] ) max_col[ label ] = last;
+	}
+
+	// ---------------------------------------------------------------------------
+	// Add
+	// Purpose: Accumulates part of an object into the object with the label.
+	// ---------------------------------------------------------------------------
+	void add( const int label, const ObjectInfo& );
+
+	// ---------------------------------------------------------------------------
+	// Add
+	// Purpose: Accumulates another table of the same size, label by label.
+	// ---------------------------------------------------------------------------
+	void add( const ObjectTable& );
+
+	// ---------------------------------------------------------------------------
+	// Get
+	// Purpose: Area and moments of the object with the label.
+	// ---------------------------------------------------------------------------
+	ObjectInfo get( const int label ) const;
+
+	// ---------------------------------------------------------------------------
+	// To_Map
+	// Purpose: Every object, label -> object info, in label order.
+	// ---------------------------------------------------------------------------
+	std::map< int, ObjectInfo > to_map( void ) const;
+
+private:
+
+	// Area and moments by label
+	std::vector< int64_t > area;
+	std::vector< int64_t > eei;
+	std::vector< int64_t > eej;
+	std::vector< int64_t > eei2;
+	std::vector< int64_t > eej2;
+	std::vector< int64_t > eeij;
+	std::vector< double > eei3;
+	std::vector< double > eej3;
+	std::vector< double > eei2j;
+	std::vector< double > eeij2;
+
+	// Perimeter and bounding box by label, see ObjectInfo
+	std::vector< int64_t > perimeter;
+	std::vector< int > min_row;
+	std::vector< int > min_col;
+	std::vector< int > max_row;
+	std::vector< int > max_col;
+
+	void resize( const int labels );
+};
+
+#endif
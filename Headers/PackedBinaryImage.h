@@ -0,0 +1,94 @@
+// ---------------------------------------------------------------------------
+// PackedBinaryImage.h
+// Binary image stored one bit per pixel, 64 pixels per word.
+// ---------------------------------------------------------------------------
+
+#ifndef _PACKEDBINARYIMAGE_
+#define _PACKEDBINARYIMAGE_
+
+#include "Image.h"
+#include <stdint.h>
+#include <vector>
+
+class PackedBinaryImage{
+
+public:
+
+	PackedBinaryImage( void );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Constructs an all background packed image.
+	//
+	// Parameters:
+	//		Parameter 1: Number of rows
+	//		Parameter 2: Number of columns
+	// ---------------------------------------------------------------------------
+	PackedBinaryImage( const int, const int );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Thresholds a greyscale image straight into packed form.
+	//			Pixels at or above the threshold value are foreground.
+	//
+	// Parameters:
+	//		Parameter 1: Image object initialized with greyscale image
+	//		Parameter 2: Threshold value
+	// ---------------------------------------------------------------------------
+	PackedBinaryImage( const Image&, const int );
+
+	// ---------------------------------------------------------------------------
+	// SetSize
+	// Purpose: Resizes the image and clears every pixel to background.
+	// ---------------------------------------------------------------------------
+	void setSize( const int rows, const int cols );
+
+	int getNRows( void ) const{ return rows; }
+	int getNCols( void ) const{ return cols; }
+	int getWordsPerRow( void ) const{ return words_per_row; }
+
+	// ---------------------------------------------------------------------------
+	// GetRow
+	// Purpose: Word access to a row. Bit ( j % 64 ) of word ( j / 64 ) holds
+	//			pixel j, bits past the last column are always 0.
+	// ---------------------------------------------------------------------------
+	uint64_t* getRow( const int i ){ return &bits[ (size_t)i * words_per_row ]; }
+	const uint64_t* getRow( const int i ) const{ return &bits[ (size_t)i * words_per_row ]; }
+
+	bool getPixel( const int i, const int j ) const{
+		return ( getRow( i )[ j >> 6 ] >> ( j & 63 ) ) & 1;
+	}
+
+	void setPixel( const int i, const int j, const bool value );
+
+	// ---------------------------------------------------------------------------
+	// Next_Run
+	// Purpose: Finds the next run of foreground pixels in a row, skipping
+	//			whole background words and locating run ends with ctz.
+	//
+	// Parameters:
+	//		1: Row
+	//		2: In: column to start searching from. Out: first column of run
+	//		3: Out: one past the last column of the run
+	// Returns: false if there is no foreground left in the row
+	// ---------------------------------------------------------------------------
+	bool next_run( const int row, int& start, int& end ) const;
+
+	// ---------------------------------------------------------------------------
+	// Unpack
+	// Purpose: Writes the image out as 0/255 pixels.
+	//
+	// Parameters:
+	// 		1: Destination image, resized to fit
+	// ---------------------------------------------------------------------------
+	void unpack( Image& image ) const;
+
+private:
+
+	int rows;
+	int cols;
+	int words_per_row;
+	std::vector< uint64_t > bits;
+};
+
+#endif
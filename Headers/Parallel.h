@@ -0,0 +1,152 @@
+// ---------------------------------------------------------------------------
+// Parallel.h
+// Splits row ranges of an image into bands and runs them on threads, or
+// hands out independent tasks to a pool of worker threads.
+// ---------------------------------------------------------------------------
+
+#ifndef _PARALLEL_
+#define _PARALLEL_
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Thread_Count
+// Purpose: Number of threads to split work over.
+//
+// Returns: Number of hardware threads, at least 1
+// ---------------------------------------------------------------------------
+inline int thread_count( void ){
+
+	const unsigned int n = std::thread::hardware_concurrency();
+	return n ? n : 1;
+}
+
+// ---------------------------------------------------------------------------
+// Serial_Bands
+// Purpose: Whether work on this thread already runs alongside work on the
+//			other hardware threads, as a parallel_tasks() worker or a
+//			server's connection does, so splitting it into bands would
+//			only add threads.
+// ---------------------------------------------------------------------------
+inline bool& serial_bands( void ){
+
+	static thread_local bool serial = false;
+	return serial;
+}
+
+// ---------------------------------------------------------------------------
+// SerialBands
+// Purpose: Makes bands run serially on this thread while in scope.
+// ---------------------------------------------------------------------------
+class SerialBands{
+
+public:
+
+	SerialBands( void ) : previous( serial_bands() ){ serial_bands() = true; }
+	~SerialBands( void ){ serial_bands() = previous; }
+
+private:
+
+	SerialBands( const SerialBands& );
+	SerialBands& operator=( const SerialBands& );
+
+	const bool previous;
+};
+
+// ---------------------------------------------------------------------------
+// Band_Count
+// Purpose: Number of bands parallel_bands() will split rows into.
+//
+// Parameters:
+//		1: Number of rows
+//		2: Requested number of bands, 0 for one per hardware thread, or
+//		   just one inside SerialBands
+// ---------------------------------------------------------------------------
+inline int band_count( const int rows, const int bands = 0 ){
+
+	int n = bands > 0 ? bands : ( serial_bands() ? 1 : thread_count() );
+	if( n > rows )
+		n = rows;
+	return n > 0 ? n : 1;
+}
+
+// ---------------------------------------------------------------------------
+// Parallel_Bands
+// Purpose: Splits rows [0, rows) into band_count( rows, bands ) contiguous
+//			bands of near equal height and calls body( first, last, band )
+//			for each, band 0 on the calling thread and the others on their
+//			own threads. Returns once every band is done.
+//
+// Parameters:
+//		1: Number of rows
+//		2: Callable taking ( int first_row, int end_row, int band )
+//		3: Requested number of bands, 0 for one per hardware thread
+// ---------------------------------------------------------------------------
+template< typename Body >
+void parallel_bands( const int rows, Body body, const int bands = 0 ){
+
+	const int n = band_count( rows, bands );
+
+	if( n == 1 ){
+		body( 0, rows, 0 );
+		return;
+	}
+
+	std::vector< std::thread > threads;
+	threads.reserve( n - 1 );
+	for( int b = 1; b < n; b++ )
+		threads.push_back( std::thread( body, (int)( (long)rows * b / n ),
+										(int)( (long)rows * ( b + 1 ) / n ), b ) );
+
+	body( 0, (int)( rows / n ), 0 );
+
+	for( size_t t = 0; t < threads.size(); t++ )
+		threads[ t ].join();
+}
+
+// ---------------------------------------------------------------------------
+// Parallel_Tasks
+// Purpose: Calls body( task, worker ) for every task in [0, tasks), each
+//			worker taking the next task as soon as it's done with one, so
+//			tasks of uneven cost keep every worker busy. Worker 0 runs on
+//			the calling thread. With several workers, bands inside a task
+//			run serially. Returns once every task is done.
+//
+// Parameters:
+//		1: Number of tasks
+//		2: Callable taking ( int task, int worker )
+//		3: Requested number of workers, 0 for one per hardware thread
+// ---------------------------------------------------------------------------
+template< typename Body >
+void parallel_tasks( const int tasks, Body body, const int workers = 0 ){
+
+	const int n = band_count( tasks, workers );
+
+	if( n == 1 ){
+		for( int task = 0; task < tasks; task++ )
+			body( task, 0 );
+		return;
+	}
+
+	std::atomic< int > next( 0 );
+
+	auto work = [ & ]( const int worker ){
+		SerialBands serial;
+		for( int task = next++; task < tasks; task = next++ )
+			body( task, worker );
+	};
+
+	std::vector< std::thread > threads;
+	threads.reserve( n - 1 );
+	for( int w = 1; w < n; w++ )
+		threads.push_back( std::thread( work, w ) );
+
+	work( 0 );
+
+	for( size_t t = 0; t < threads.size(); t++ )
+		threads[ t ].join();
+}
+
+#endif
@@ -0,0 +1,107 @@
+// ---------------------------------------------------------------------------
+// RunLengthImage.h
+// Binary or labeled image stored as horizontal runs of foreground pixels.
+// ---------------------------------------------------------------------------
+
+#ifndef _RUNLENGTHIMAGE_
+#define _RUNLENGTHIMAGE_
+
+#include "Image.h"
+#include "PackedBinaryImage.h"
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Run
+// Purpose: Foreground pixels [start, end) of a row, all with the same label.
+// ---------------------------------------------------------------------------
+struct Run{
+	int start;
+	int end;
+	int label;
+};
+
+class RunLengthImage{
+
+public:
+
+	RunLengthImage( void );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Encodes the runs of non-zero pixels of an image. Labels are 0.
+	//
+	// Parameters:
+	//		Parameter 1: Binary image
+	// ---------------------------------------------------------------------------
+	explicit RunLengthImage( const Image& );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Encodes the runs of non-zero pixels of image rows [first, last),
+	//			image row first becoming row 0. Labels are 0.
+	//
+	// Parameters:
+	//		Parameter 1: Binary image
+	//		Parameter 2: First row
+	//		Parameter 3: End row
+	// ---------------------------------------------------------------------------
+	RunLengthImage( const Image&, const int, const int );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Encodes the runs of set bits of a packed image. Labels are 0.
+	//
+	// Parameters:
+	//		Parameter 1: Packed binary image
+	// ---------------------------------------------------------------------------
+	explicit RunLengthImage( const PackedBinaryImage& );
+
+	// ---------------------------------------------------------------------------
+	// CONSTRUCTOR
+	// Purpose: Encodes the runs of set bits of rows [first, last), row first
+	//			becoming row 0. Labels are 0.
+	//
+	// Parameters:
+	//		Parameter 1: Packed binary image
+	//		Parameter 2: First row
+	//		Parameter 3: End row
+	// ---------------------------------------------------------------------------
+	RunLengthImage( const PackedBinaryImage&, const int, const int );
+
+	int getNRows( void ) const{ return (int)row_start.size() - 1; }
+	int getNCols( void ) const{ return cols; }
+	int getNRuns( void ) const{ return (int)runs.size(); }
+
+	// ---------------------------------------------------------------------------
+	// Row Access
+	// Purpose: Runs of row i are [ begin( i ), end( i ) ), ordered by column.
+	// ---------------------------------------------------------------------------
+	Run* begin( const int i ){ return runs.data() + row_start[ i ]; }
+	Run* end( const int i ){ return runs.data() + row_start[ i + 1 ]; }
+	const Run* begin( const int i ) const{ return runs.data() + row_start[ i ]; }
+	const Run* end( const int i ) const{ return runs.data() + row_start[ i + 1 ]; }
+
+	// ---------------------------------------------------------------------------
+	// Index
+	// Purpose: Position of run r in raster order.
+	// ---------------------------------------------------------------------------
+	int index( const Run* r ) const{ return (int)( r - runs.data() ); }
+
+private:
+
+	int cols;
+
+	// Every run in raster order
+	std::vector< Run > runs;
+
+	// Runs of row i start at runs[ row_start[ i ] ], rows + 1 entries
+	std::vector< int > row_start;
+
+	// ---------------------------------------------------------------------------
+	// Add_Row_Runs
+	// Purpose: Appends the runs of a packed row and closes the row.
+	// ---------------------------------------------------------------------------
+	void add_row_runs( const PackedBinaryImage& bits, const int i );
+};
+
+#endif
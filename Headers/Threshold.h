@@ -0,0 +1,82 @@
+// ---------------------------------------------------------------------------
+// Threshold.h
+// Row thresholding kernels used to turn grey-level rows into binary rows.
+// The widest instruction set the CPU supports (AVX-512, AVX2 or SSE2) is
+// picked at run time, with a plain C++ loop as the fallback. Also picks
+// global thresholds automatically from the grey-level histogram.
+// ---------------------------------------------------------------------------
+
+#ifndef _THRESHOLD_
+#define _THRESHOLD_
+
+#include "Image.h"
+#include <stdint.h>
+
+// ---------------------------------------------------------------------------
+// Threshold_Row
+// Purpose: Writes 255 to dst for every pixel of src at or above the
+//			threshold value and 0 for every pixel below it. src and dst
+//			may be the same row.
+//
+// Parameters:
+//		Parameter 1: Source row
+//		Parameter 2: Destination row
+//		Parameter 3: Number of pixels in the row
+//		Parameter 4: Threshold value
+// ---------------------------------------------------------------------------
+void threshold_row( const unsigned char* src, unsigned char* dst,
+					const int length, const int threshold );
+
+// ---------------------------------------------------------------------------
+// Threshold_Row_Mask
+// Purpose: Packs the thresholded row into bits, 64 pixels per word. Bit
+//			( j % 64 ) of word ( j / 64 ) is set when pixel j is at or
+//			above the threshold value. Unused bits of the last word are 0.
+//
+// Parameters:
+//		Parameter 1: Source row
+//		Parameter 2: Destination words, ( length + 63 ) / 64 of them
+//		Parameter 3: Number of pixels in the row
+//		Parameter 4: Threshold value
+// ---------------------------------------------------------------------------
+void threshold_row_mask( const unsigned char* src, uint64_t* bits,
+						 const int length, const int threshold );
+
+// ---------------------------------------------------------------------------
+// Threshold_Kernel_Name
+// Purpose: Name of the instruction set the kernels run with on this CPU.
+// ---------------------------------------------------------------------------
+const char* threshold_kernel_name( void );
+
+// ---------------------------------------------------------------------------
+// Compute_Histogram
+// Purpose: Counts the pixels of each grey level in one pass over the image.
+//			Each row band is counted on its own thread into its own
+//			sub-histogram, and the sub-histograms are summed at the end.
+//
+// Parameters:
+//		Parameter 1: Greyscale image
+//		Parameter 2: Out: 256 pixel counts
+// ---------------------------------------------------------------------------
+void compute_histogram( const Image&, unsigned long histogram[ 256 ] );
+
+// ---------------------------------------------------------------------------
+// Otsu_Threshold
+// Purpose: Picks the threshold that maximizes the between-class variance of
+//			the background and foreground grey levels (Otsu's method).
+//
+// Returns: Threshold value, pixels at or above it are foreground
+// ---------------------------------------------------------------------------
+int otsu_threshold( const unsigned long histogram[ 256 ] );
+
+// ---------------------------------------------------------------------------
+// Triangle_Threshold
+// Purpose: Picks the threshold at the histogram bin farthest from the line
+//			joining the histogram peak to the end of its longer tail
+//			(Zack's triangle method). Suits one dominant background peak.
+//
+// Returns: Threshold value, pixels at or above it are foreground
+// ---------------------------------------------------------------------------
+int triangle_threshold( const unsigned long histogram[ 256 ] );
+
+#endif
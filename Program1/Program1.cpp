@@ -8,6 +8,7 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
 #include "BinaryImage.h" //Inherits from Image
 
 int main( int argc, char** argv ){
@@ -18,11 +19,26 @@ int main( int argc, char** argv ){
 	}
 	
 	const char* input_file = argv[1]; // input file
-	const double threshold_value = atof( argv[2] ); // gray-level threshold
+	const char* threshold_arg = argv[2]; // gray-level threshold, "otsu", "triangle", "mean" or "sauvola"
 	const char* output_file = argv[3]; // output file
+	const int window_size = ( argc > 4 ) ? atoi( argv[4] ) : 31; // adaptive window size
+	const double k = ( argc > 5 ) ? atof( argv[5] ) : 0.2; // adaptive sensitivity
 	
 	// Create BinaryImage(Inherits from Image) object on the heap in case of a large image file
-	BinaryImage* bin = new BinaryImage( input_file, threshold_value );
+	BinaryImage* bin;
+	if( strcmp( threshold_arg, "otsu" ) == 0 )
+		bin = new BinaryImage( input_file, THRESHOLD_OTSU );
+	else if( strcmp( threshold_arg, "triangle" ) == 0 )
+		bin = new BinaryImage( input_file, THRESHOLD_TRIANGLE );
+	else if( strcmp( threshold_arg, "mean" ) == 0 )
+		bin = new BinaryImage( input_file, THRESHOLD_MEAN, window_size, k );
+	else if( strcmp( threshold_arg, "sauvola" ) == 0 )
+		bin = new BinaryImage( input_file, THRESHOLD_SAUVOLA, window_size, k );
+	else
+		bin = new BinaryImage( input_file, atoi( threshold_arg ) );
+
+	if( bin->getThreshold() >= 0 )
+		std::cout << "Threshold: " << bin->getThreshold() << std::endl;
 
 	bin->setColors( 1 ); // Set PGM Header colors to 1 since it's a binary image
 	
@@ -7,6 +7,8 @@
 // ---------------------------------------------------------------------------
 
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 #include "LabeledImage.h"
 
 int main(int argc, char** argv){
@@ -18,9 +20,44 @@ int main(int argc, char** argv){
 
 	const char* input_file = argv[ 1 ]; // input file
 	const char* output_file = argv[ 2 ]; // output file
+	const char* method_name = ( argc > 3 ) ? argv[ 3 ] : "twopass"; // labeling engine
+	const int neighbours = ( argc > 4 ) ? atoi( argv[ 4 ] ) : 4; // connectivity
+	const char* numbering = ( argc > 5 ) ? argv[ 5 ] : "raster"; // object numbering
+
+	LabelingMethod method = LABEL_TWO_PASS;
+	if( strcmp( method_name, "runs" ) == 0 )
+		method = LABEL_RUN_LENGTH;
+	else if( strcmp( method_name, "blocks" ) == 0 )
+		method = LABEL_BLOCK;
+	else if( strcmp( method_name, "parallel" ) == 0 )
+		method = LABEL_PARALLEL;
+	else if( strcmp( method_name, "twopass" ) != 0 ){
+		std::cout << "Unknown labeling method " << method_name << " (twopass, runs, blocks, parallel)" << std::endl;
+		return -1;
+	}
+
+	if( neighbours != 4 && neighbours != 8 ){
+		std::cout << "Connectivity must be 4 or 8" << std::endl;
+		return -1;
+	}
+	const Connectivity connectivity = ( neighbours == 8 ) ? CONNECTIVITY_8 : CONNECTIVITY_4;
+
+	// Parallel labeling numbers objects in raster order unless told any
+	// order will do
+	if( strcmp( numbering, "raster" ) != 0 && strcmp( numbering, "any" ) != 0 ){
+		std::cout << "Unknown numbering " << numbering << " (raster, any)" << std::endl;
+		return -1;
+	}
+	const bool deterministic = strcmp( numbering, "raster" ) == 0;
 
 	// Create LabeledImage (Inherits from Image) on the heap in case of large file
-	LabeledImage* lab = new LabeledImage( input_file, true );
+	LabeledImage* lab = new LabeledImage( input_file, true, method, connectivity, deterministic );
+
+	// Grey levels of the image written repeat past 255 objects, so they no
+	// longer tell every object apart
+	if( lab->get_object_count() > 255 )
+		std::cout << lab->get_object_count() << " objects, grey levels repeat past 255: "
+				  << "label with Program3 \"binary\" to measure them all" << std::endl;
 
 	// Write/Create image
 	writeImage( lab, output_file );
@@ -15,6 +15,8 @@
 #include <utility>
 #include <set>
 #include <cmath>
+#include <cstring>
+#include <stdexcept>
 #include "LabeledImage.h"
 
 int main(int argc, char** argv){
@@ -28,11 +30,33 @@ int main(int argc, char** argv){
 	const char* output_file = argv[ 2 ]; // output file
 	const char* output_image = argv[ 3 ]; // output image
 
+	// Options: "binary" labels a binary input here, measuring objects while
+	// labeling, "bindb" writes a binary database, "append" adds the objects
+	// to the database already there, so runs on many images can build one
+	bool binary = false;
+	bool append = false;
+	DatabaseFormat format = DB_TEXT;
+	for( int a = 4; a < argc; a++ ){
+		if( strcmp( argv[ a ], "binary" ) == 0 )
+			binary = true;
+		else if( strcmp( argv[ a ], "bindb" ) == 0 )
+			format = DB_BINARY;
+		else if( strcmp( argv[ a ], "append" ) == 0 )
+			append = true;
+	}
+
 	// Create Labeled Image (Inherits from Image) on the heap in case of large image
-	LabeledImage* lab = new LabeledImage( input_file, false );
+	LabeledImage* lab = new LabeledImage( input_file, binary, LABEL_MOMENTS );
 	
 	// Get objects & process the data
-	lab->process_data( output_file );
+	try{
+		lab->process_data( output_file, format, append );
+	}
+	catch( const std::runtime_error& e ){
+		std::cout << e.what() << std::endl;
+		delete lab;
+		return -1;
+	}
 
 	// Write/Create image
 	writeImage( lab, output_image );
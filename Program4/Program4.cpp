@@ -3,6 +3,9 @@
 // Compares a labeled image to database containing label, center row, center
 // column, inertial mass, and orientation. It then draws lines on the image
 // to indicate a match between a database entry and an object in the image.
+// In batch mode every image of a directory or list file is matched against
+// the database, loaded once, and the matches of all of them are written to
+// one results file.
 // 
 // Author: Andrew Miloslavsky
 // Date: October 2nd, 2015
@@ -14,7 +17,84 @@
 #include <map>
 #include <sstream>
 #include <vector>
+#include <set>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
 #include "LabeledImage.h"
+#include "MatchBatch.h"
+
+// ---------------------------------------------------------------------------
+// Run_Batch
+// Purpose: Matches every image of a directory or list file, writing
+//			output_dir/<name>_match.pgm for each and output_dir/results.txt.
+//			Images of a list sharing a name, from different directories,
+//			get <name>_2, <name>_3, ... after the first.
+//
+// Parameters:
+//		1: Directory or list file of images
+//		2: Database path
+//		3: Output directory, made if missing
+//		4: How to pair entries with objects
+//		5: Label binary inputs?
+//
+// Returns: 0 if every image was matched, -1 otherwise
+// ---------------------------------------------------------------------------
+static int run_batch( const char* inputs, const char* database, const char* output_dir,
+					  const MatchMethod method, const bool binary ){
+
+	const std::vector< std::string > images = MatchBatch::list_images( inputs );
+	if( images.empty() ){
+		std::cout << "No images in " << inputs << std::endl;
+		return -1;
+	}
+
+	mkdir( output_dir, 0777 );
+
+	std::vector< std::string > outputs;
+	std::set< std::string > names;
+	for( size_t i = 0; i < images.size(); i++ ){
+
+		std::string name = images[ i ].substr( images[ i ].find_last_of( '/' ) + 1 );
+		if( name.size() > 4 && name.compare( name.size() - 4, 4, ".pgm" ) == 0 )
+			name.erase( name.size() - 4 );
+
+		// Two workers must never write the same output
+		std::string unique = name;
+		for( int n = 2; !names.insert( unique ).second; n++ ){
+			std::ostringstream numbered;
+			numbered << name << "_" << n;
+			unique = numbered.str();
+		}
+
+		outputs.push_back( std::string( output_dir ) + "/" + unique + "_match.pgm" );
+		if( unique != name )
+			std::cout << images[ i ] << " written as " << outputs.back() << std::endl;
+	}
+
+	// Load the database and build its index once for every image
+	const ObjectDatabase db( database );
+	const MatchBatch batch( db, method );
+
+	const std::vector< ImageMatches > results = batch.run( images, outputs, binary );
+
+	const std::string results_file = std::string( output_dir ) + "/results.txt";
+	if( batch.write_results( results_file.c_str(), results ) < 0 ){
+		std::cout << "Cannot write " << results_file << std::endl;
+		return -1;
+	}
+
+	size_t failed = 0, matches = 0;
+	for( size_t r = 0; r < results.size(); r++ ){
+		failed += !results[ r ].ok;
+		matches += results[ r ].matches.size();
+	}
+
+	std::cout << "Matched " << images.size() - failed << " of " << images.size()
+			  << " images, " << matches << " matches" << std::endl;
+
+	return failed ? -1 : 0;
+}
 
 int main(int argc, char** argv){
 
@@ -28,11 +108,54 @@ int main(int argc, char** argv){
 	const char* database = argv[ 2 ];
 	const char* output_image = argv[ 3 ];
 
+	// Options: "binary" labels a binary input here, measuring objects while
+	// labeling, "nearest" matches objects to their nearest entries in
+	// feature space through an index, "scan" by scoring every entry,
+	// "assign" pairs objects and entries one to one. "batch" matches the
+	// images of a directory or list file into an output directory, as
+	// does a directory input
+	bool binary = false;
+	bool batch = false;
+	MatchMethod method = MATCH_AREA;
+	for( int a = 4; a < argc; a++ ){
+		if( strcmp( argv[ a ], "binary" ) == 0 )
+			binary = true;
+		else if( strcmp( argv[ a ], "nearest" ) == 0 )
+			method = MATCH_NEAREST;
+		else if( strcmp( argv[ a ], "scan" ) == 0 )
+			method = MATCH_SCAN;
+		else if( strcmp( argv[ a ], "assign" ) == 0 )
+			method = MATCH_ASSIGN;
+		else if( strcmp( argv[ a ], "batch" ) == 0 )
+			batch = true;
+	}
+
+	struct stat info;
+	if( stat( input_image, &info ) == 0 && S_ISDIR( info.st_mode ) )
+		batch = true;
+
+	if( batch ){
+		try{
+			return run_batch( input_image, database, output_image, method, binary );
+		}
+		catch( const std::runtime_error& e ){
+			std::cout << e.what() << std::endl;
+			return -1;
+		}
+	}
+
 	// Create new labeled image 
-	LabeledImage* lab = new LabeledImage( input_image, false );
+	LabeledImage* lab = new LabeledImage( input_image, binary, LABEL_MOMENTS );
 
 	// Compare the labeled image to the database
-	lab->compare_to( database );
+	try{
+		lab->compare_to( database, method );
+	}
+	catch( const std::runtime_error& e ){
+		std::cout << e.what() << std::endl;
+		delete lab;
+		return -1;
+	}
 
 	// Write/Create image
 	writeImage( lab, output_image );
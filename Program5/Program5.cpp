@@ -0,0 +1,73 @@
+// ---------------------------------------------------------------------------
+// Program5.cpp
+// Converts an object database between the text format written by Program3
+// and the binary format that is mapped into memory when it is loaded, or
+// merges one into another.
+// ---------------------------------------------------------------------------
+
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include "ObjectDatabase.h"
+
+int main(int argc, char** argv){
+
+	if( argc < 3 ) {
+		std::cout << "Not enough arguments! (2)" << std::endl;
+		return -1;
+	}
+
+	const char* input_file = argv[ 1 ]; // input database
+	const char* output_file = argv[ 2 ]; // output database
+
+	try{
+
+		ObjectDatabase database( input_file );
+
+		// Options: "text" or "binary" is the output format, "append" adds the
+		// entries to the output database, skipping near duplicates
+		bool append = false;
+		bool format_given = false;
+		DatabaseFormat format = DB_TEXT;
+		for( int a = 3; a < argc; a++ ){
+			if( strcmp( argv[ a ], "text" ) == 0 ){
+				format = DB_TEXT;
+				format_given = true;
+			}
+			else if( strcmp( argv[ a ], "binary" ) == 0 ){
+				format = DB_BINARY;
+				format_given = true;
+			}
+			else if( strcmp( argv[ a ], "append" ) == 0 )
+				append = true;
+		}
+
+		if( append ){
+
+			// A new output keeps the input's format unless told otherwise
+			const int added = database.append( output_file, format_given ? format : database.getFormat() );
+			if( added < 0 ){
+				std::cout << "Cannot write " << output_file << std::endl;
+				return -1;
+			}
+
+			std::cout << "Added " << added << " of " << database.size() << " entries to " << output_file << std::endl;
+			return 0;
+		}
+
+		// Converts to the other format unless told which
+		if( !format_given )
+			format = ( database.getFormat() == DB_TEXT ) ? DB_BINARY : DB_TEXT;
+
+		if( database.write( output_file, format ) < 0 ){
+			std::cout << "Cannot write " << output_file << std::endl;
+			return -1;
+		}
+	}
+	catch( const std::runtime_error& e ){
+		std::cout << e.what() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,47 @@
+// ---------------------------------------------------------------------------
+// Program6.cpp
+// Match server: loads and indexes an object database once, then matches
+// frames sent by local producers over a Unix domain socket, see
+// MatchServer.h for the protocol. The database is reloaded whenever its
+// file changes.
+// ---------------------------------------------------------------------------
+
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include "MatchServer.h"
+
+int main(int argc, char** argv){
+
+	if( argc < 3 ) {
+		std::cout << "Not enough arguments! (2)" << std::endl;
+		return -1;
+	}
+
+	const char* database = argv[ 1 ]; // database
+	const char* socket_path = argv[ 2 ]; // socket to listen on
+
+	// Options: "area", "scan" or "assign" pair entries with objects as in
+	// Program4, the default is the nearest entry through an index
+	MatchMethod method = MATCH_NEAREST;
+	for( int a = 3; a < argc; a++ ){
+		if( strcmp( argv[ a ], "area" ) == 0 )
+			method = MATCH_AREA;
+		else if( strcmp( argv[ a ], "scan" ) == 0 )
+			method = MATCH_SCAN;
+		else if( strcmp( argv[ a ], "assign" ) == 0 )
+			method = MATCH_ASSIGN;
+	}
+
+	try{
+
+		MatchServer server( database, method );
+
+		std::cout << "Matching on " << socket_path << std::endl;
+		return server.serve( socket_path );
+	}
+	catch( const std::runtime_error& e ){
+		std::cout << e.what() << std::endl;
+		return -1;
+	}
+}
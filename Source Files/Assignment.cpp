@@ -0,0 +1,125 @@
+// ---------------------------------------------------------------------------
+// Assignment.cpp
+// Solves the assignment problem: pairs every row of a cost matrix with its
+// own column so the summed cost of the pairs is least. The matrix is given
+// sparse, as the arcs of each row; missing pairs can't be made.
+// ---------------------------------------------------------------------------
+
+#include "Assignment.h"
+#include <stddef.h>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+// ---------------------------------------------------------------------------
+// Solve_Assignment
+// Purpose: Adds the rows one at a time. Each new row is joined by the
+//			shortest path, in reduced costs, from it to a free column, going
+//			from a column to the row paired with it and on along that row's
+//			arcs, and the pairs along the path shift over. Row and column
+//			potentials keep reduced costs of arcs non negative, and zero on
+//			pairs, so Dijkstra's algorithm finds each path.
+// ---------------------------------------------------------------------------
+std::vector< int > solve_assignment( const std::vector< std::vector< Arc > >& arcs, const int cols ){
+
+	const int rows = (int)arcs.size();
+	const double infinity = std::numeric_limits< double >::infinity();
+
+	std::vector< double > row_potential( rows, 0 );
+	std::vector< double > col_potential( cols, 0 );
+	std::vector< int > row_col( rows, -1 );
+	std::vector< int > col_row( cols, -1 );
+
+	// Dijkstra state, reset through touched after each row
+	std::vector< double > reach( cols, infinity );	// Shortest distance to each column
+	std::vector< int > from( cols, -1 );			// Row each column was reached from
+	std::vector< char > done( cols, 0 );
+	std::vector< int > touched;
+	std::vector< int > settled;
+
+	typedef std::pair< double, int > Entry;
+	typedef std::priority_queue< Entry, std::vector< Entry >, std::greater< Entry > > Queue;
+	Queue queue;
+
+	// Relaxes the arcs of row r, reached at distance d
+	auto relax = [ & ]( const int r, const double d ){
+
+		const std::vector< Arc >& out = arcs[ r ];
+		for( size_t a = 0; a < out.size(); a++ ){
+
+			const int c = out[ a ].col;
+			if( done[ c ] )
+				continue;
+
+			const double distance = d + out[ a ].cost - row_potential[ r ] - col_potential[ c ];
+			if( distance < reach[ c ] ){
+				if( reach[ c ] == infinity )
+					touched.push_back( c );
+				reach[ c ] = distance;
+				from[ c ] = r;
+				queue.push( Entry( distance, c ) );
+			}
+		}
+	};
+
+	for( int start = 0; start < rows; start++ ){
+
+		relax( start, 0 );
+
+		// Settle columns nearest first until a free one
+		int end = -1;
+		double length = 0;
+		while( !queue.empty() ){
+
+			const Entry top = queue.top();
+			queue.pop();
+
+			const int c = top.second;
+			if( done[ c ] || top.first > reach[ c ] )
+				continue;
+
+			done[ c ] = 1;
+			if( col_row[ c ] < 0 ){
+				end = c;
+				length = top.first;
+				break;
+			}
+
+			settled.push_back( c );
+			relax( col_row[ c ], top.first );
+		}
+
+		if( end < 0 )
+			throw std::runtime_error( "Rows can't all be assigned" );
+
+		// Keep reduced costs non negative and zero on the new pairs
+		row_potential[ start ] += length;
+		for( size_t s = 0; s < settled.size(); s++ ){
+			const int c = settled[ s ];
+			const double slack = length - reach[ c ];
+			col_potential[ c ] -= slack;
+			row_potential[ col_row[ c ] ] += slack;
+		}
+
+		// Shift the pairs along the path
+		for( int c = end; c >= 0; ){
+			const int r = from[ c ];
+			const int next = row_col[ r ];
+			row_col[ r ] = c;
+			col_row[ c ] = r;
+			c = next;
+		}
+
+		for( size_t t = 0; t < touched.size(); t++ ){
+			reach[ touched[ t ] ] = infinity;
+			done[ touched[ t ] ] = 0;
+		}
+		touched.clear();
+		settled.clear();
+		queue = Queue();
+	}
+
+	return row_col;
+}
@@ -7,6 +7,11 @@
 // ---------------------------------------------------------------------------
 
 #include "BinaryImage.h"
+#include "Threshold.h"
+#include "Parallel.h"
+#include "IntegralImage.h"
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
 
 // ---------------------------------------------------------------------------
@@ -18,10 +23,10 @@
 //		Parameter 1: Image object initialized with greyscale image
 //		Parameter 2: Threshold value
 // ---------------------------------------------------------------------------
-BinaryImage::BinaryImage( const Image& image, const int threshold ) : Image( image ){ 
+BinaryImage::BinaryImage( const Image& image, const int threshold ){ 
 	
-	// Convert image to binary
-	greyscale_to_binary( threshold ); 
+	// Threshold straight out of the source, no copy of the grey levels
+	greyscale_to_binary( image, threshold ); 
 }
 
 // ---------------------------------------------------------------------------
@@ -35,38 +40,217 @@ BinaryImage::BinaryImage( const Image& image, const int threshold ) : Image( ima
 // ---------------------------------------------------------------------------
 BinaryImage::BinaryImage( const char* file, const int threshold ){
 	
-	// Try to read file into 'image' object
-	if(readImage( this, file ) == -1 ){
+	// Try to map file, the grey levels are only read once
+	Image greyscale;
+	read_greyscale( file, greyscale );
+
+	// Convert image to binary
+	greyscale_to_binary( greyscale, threshold );
+}
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Constructs a binary image from an image, picking the threshold
+//			value automatically.
+//
+// Parameters:
+//		Parameter 1: Image object initialized with greyscale image
+//		Parameter 2: Threshold method
+//		Parameter 3: Adaptive methods: width and height of the window
+//		Parameter 4: Adaptive methods: sensitivity k
+// ---------------------------------------------------------------------------
+BinaryImage::BinaryImage( const Image& image, const ThresholdMethod method,
+						  const int window_size, const double k ){
+
+	convert( image, method, window_size, k );
+}
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Constructs a binary image from an image file, picking the 
+//			threshold value automatically.
+//
+// Parameters:
+//		Parameter 1: Image file path
+//		Parameter 2: Threshold method
+//		Parameter 3: Adaptive methods: width and height of the window
+//		Parameter 4: Adaptive methods: sensitivity k
+// ---------------------------------------------------------------------------
+BinaryImage::BinaryImage( const char* file, const ThresholdMethod method,
+						  const int window_size, const double k ){
+
+	// The mapped grey levels are read once for the histogram (or the
+	// summed-area tables) and once more by the thresholding, which also
+	// makes the copy
+	Image greyscale;
+	read_greyscale( file, greyscale );
+
+	convert( greyscale, method, window_size, k );
+}
+
+BinaryImage::~BinaryImage( void ){ }
+
+// ---------------------------------------------------------------------------
+// PACK
+// Purpose: Packs this binary image into one bit per pixel.
+//
+// Returns: Packed image with every non-zero pixel set
+// ---------------------------------------------------------------------------
+PackedBinaryImage BinaryImage::pack( void ) const{
+
+	return PackedBinaryImage( *this, 1 );
+}
+
+// ---------------------------------------------------------------------------
+// PICK_THRESHOLD
+// Purpose: Computes the threshold value for a method from the histogram.
+//
+// Parameters:
+//		Parameter 1: Greyscale image
+//		Parameter 2: Threshold method
+// ---------------------------------------------------------------------------
+int BinaryImage::pick_threshold( const Image& greyscale, const ThresholdMethod method ){
+
+	unsigned long histogram[ 256 ];
+	compute_histogram( greyscale, histogram );
+
+	switch( method ){
+		case THRESHOLD_OTSU:
+			return otsu_threshold( histogram );
+		case THRESHOLD_TRIANGLE:
+			return triangle_threshold( histogram );
+		default:
+			break;
+	}
+
+	throw std::invalid_argument( "Not a global threshold method" );
+}
+
+// ---------------------------------------------------------------------------
+// CONVERT
+// Purpose: Converts with the global or adaptive method given.
+// ---------------------------------------------------------------------------
+void BinaryImage::convert( const Image& greyscale, const ThresholdMethod method,
+						   const int window_size, const double k ){
+
+	if( method == THRESHOLD_MEAN || method == THRESHOLD_SAUVOLA )
+		adaptive_to_binary( greyscale, method, window_size, k );
+	else
+		greyscale_to_binary( greyscale, pick_threshold( greyscale, method ) );
+}
+
+// ---------------------------------------------------------------------------
+// READ_GREYSCALE
+// Purpose: Maps an image file, throwing if it can't be read.
+//
+// Parameters:
+//		Parameter 1: Image file path
+//		Parameter 2: Out: greyscale image
+// ---------------------------------------------------------------------------
+void BinaryImage::read_greyscale( const char* file, Image& greyscale ){
+
+	if( mapImage( &greyscale, file ) == -1 ){
 		if( !file )
 			throw std::invalid_argument( "Invalid input file" );
 		
 		throw std::bad_alloc();
 	}
-
-	// Convert image to binary
-	greyscale_to_binary( threshold );
 }
 
-BinaryImage::~BinaryImage( void ){ }
-
 // ---------------------------------------------------------------------------
 // GREYSCALE_TO_BINARY
 // Purpose: Converts a greyscale image to a binary image using a threshold 
-//			value.
+//			value, writing the result into this image.
 //
 // Parameters:
-//		Parameter 1: Threshold value
+//		Parameter 1: Greyscale image
+//		Parameter 2: Threshold value
 // ---------------------------------------------------------------------------
-void BinaryImage::greyscale_to_binary( int threshold_value ){
+void BinaryImage::greyscale_to_binary( const Image& greyscale, const int threshold_value ){
 	
-	for ( int i = 0; i < getNRows(); i++ ){
-		for( int k = 0; k < getNCols(); k++ ){
-			
-			// Get pixel value at i, k
-			const int pixel_value = getPixel( i,k );
-			
-			// Set pixel value at i, k to 0 or 255 (Black or White)
-			setPixel( i, k, ( pixel_value < threshold_value ) ? 0 : 255 );
+	const int rows = greyscale.getNRows();
+	const int cols = greyscale.getNCols();
+
+	if( setSize( rows, cols ) < 0 )
+		throw std::bad_alloc();
+	setColors( greyscale.getColors() );
+	threshold = threshold_value;
+
+	// Set each pixel to 0 or 255 (Black or White), a whole row at a time,
+	// with each band of rows on its own thread
+	parallel_bands( rows, [ & ]( const int first, const int last, int ){
+		for ( int i = first; i < last; i++ )
+			threshold_row( greyscale.getRow( i ), getRow( i ), cols, threshold_value );
+	} );
+}
+
+// ---------------------------------------------------------------------------
+// ADAPTIVE_TO_BINARY
+// Purpose: Converts a greyscale image to a binary image with a threshold
+//			computed for every pixel from the window around it.
+//
+//			Objects are brighter than the background, so both methods are
+//			applied to the inverted grey levels, where objects are dark:
+//				Mean:    p' < m' * ( 1 - k )
+//				Sauvola: p' < m' * ( 1 + k * ( s / 128 - 1 ) )
+//			with p' = 255 - p, m' = 255 - local mean, s = local deviation.
+//
+// Parameters:
+//		Parameter 1: Greyscale image
+//		Parameter 2: THRESHOLD_MEAN or THRESHOLD_SAUVOLA
+//		Parameter 3: Width and height of the window
+//		Parameter 4: Sensitivity k
+// ---------------------------------------------------------------------------
+void BinaryImage::adaptive_to_binary( const Image& greyscale, const ThresholdMethod method,
+									  const int window_size, const double k ){
+
+	if( window_size < 1 )
+		throw std::invalid_argument( "Window size must be positive" );
+
+	const int rows = greyscale.getNRows();
+	const int cols = greyscale.getNCols();
+	const int half = window_size / 2;
+	const bool sauvola = ( method == THRESHOLD_SAUVOLA );
+
+	// Dynamic range of the standard deviation
+	const double R = 128;
+
+	const IntegralImage integral( greyscale, sauvola );
+
+	if( setSize( rows, cols ) < 0 )
+		throw std::bad_alloc();
+	setColors( greyscale.getColors() );
+	threshold = -1;
+
+	parallel_bands( rows, [ & ]( const int first, const int last, int ){
+
+		for( int i = first; i < last; i++ ){
+
+			// Window rows, clipped to the image
+			const int r0 = std::max( i - half, 0 );
+			const int r1 = std::min( i + half + 1, rows );
+
+			const unsigned char* src = greyscale.getRow( i );
+			unsigned char* dst = getRow( i );
+
+			for( int j = 0; j < cols; j++ ){
+
+				const int c0 = std::max( j - half, 0 );
+				const int c1 = std::min( j + half + 1, cols );
+				const double area = (double)( r1 - r0 ) * ( c1 - c0 );
+
+				const double mean = integral.sum( r0, c0, r1, c1 ) / area;
+
+				double factor = 1 - k;
+				if( sauvola ){
+					const double variance = integral.sum_squares( r0, c0, r1, c1 ) / area - mean * mean;
+					const double deviation = variance > 0 ? std::sqrt( variance ) : 0;
+					factor = 1 + k * ( deviation / R - 1 );
+				}
+
+				// Set pixel to 0 or 255 (Black or White)
+				dst[ j ] = ( 255 - src[ j ] < ( 255 - mean ) * factor ) ? 255 : 0;
+			}
 		}
-	}
-}
\ No newline at end of file
+	} );
+}
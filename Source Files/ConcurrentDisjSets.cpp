@@ -0,0 +1,61 @@
+#include "ConcurrentDisjSets.h"
+
+/**
+ * Construct the disjoint sets object.
+ * numElements is the number of disjoint sets.
+ */
+ConcurrentDisjSets::ConcurrentDisjSets( int numElements ) : parent( numElements )
+{
+    for( int i = 0; i < (int)parent.size( ); i++ )
+        parent[ i ].store( i, std::memory_order_relaxed );
+}
+
+/**
+ * Perform a find with path halving.
+ * Each step points x at its grandparent. Another thread may have moved
+ * the parent meanwhile, in which case the halving is simply skipped:
+ * parents only move to smaller elements of the same set, so any value
+ * read is still on the path to the root.
+ * Return the set containing x.
+ */
+int ConcurrentDisjSets::find( int x )
+{
+    int p = parent[ x ].load( std::memory_order_relaxed );
+    while( p != x )
+    {
+        int gp = parent[ p ].load( std::memory_order_relaxed );
+        if( gp != p )
+            parent[ x ].compare_exchange_weak( p, gp, std::memory_order_relaxed );
+        x = p;
+        p = parent[ x ].load( std::memory_order_relaxed );
+    }
+    return x;
+}
+
+/**
+ * Union the sets containing x and y.
+ * The larger root is linked under the smaller one only if it is still a
+ * root, otherwise another thread got there first and the roots are
+ * found again.
+ */
+void ConcurrentDisjSets::unionSets( int x, int y )
+{
+    for( ;; )
+    {
+        x = find( x );
+        y = find( y );
+        if( x == y )
+            return;
+
+        if( x < y )
+        {
+            int t = x;
+            x = y;
+            y = t;
+        }
+
+        int expected = x;
+        if( parent[ x ].compare_exchange_strong( expected, y, std::memory_order_acq_rel ) )
+            return;
+    }
+}
@@ -10,6 +10,16 @@ DisjSets::DisjSets( int numElements ) : s( numElements )
         s[ i ] = -1;
 }
 
+/**
+ * Add a new single element set, growing the table.
+ * Return the new element, numbered after all the others.
+ */
+int DisjSets::makeSet( )
+{
+    s.push_back( -1 );
+    return s.size( ) - 1;
+}
+
 /**
  * Union two disjoint sets.
  * For simplicity, we assume root1 and root2 are distinct
@@ -33,26 +43,34 @@ void DisjSets::unionSets( int root1, int root2 )
 /**
  * Perform a find.
  * Error checks omitted again for simplicity.
+ * Walks up the tree with a loop, so long chains can't overflow the stack.
  * Return the set containing x.
  */
 int DisjSets::find( int x ) const
 {
-    if( s[ x ] < 0 )
-        return x;
-    else
-        return find( s[ x ] );
+    while( s[ x ] >= 0 )
+        x = s[ x ];
+    return x;
 }
 
 
 /**
  * Perform a find with path compression.
  * Error checks omitted again for simplicity.
+ * One loop finds the root, a second points the whole path at it.
  * Return the set containing x.
  */
 int DisjSets::find( int x )
 {
-    if( s[ x ] < 0 )
-        return x;
-    else
-        return s[ x ] = find( s[ x ] );
+    int root = x;
+    while( s[ root ] >= 0 )
+        root = s[ root ];
+
+    while( s[ x ] >= 0 )
+    {
+        int next = s[ x ];
+        s[ x ] = root;
+        x = next;
+    }
+    return root;
 }
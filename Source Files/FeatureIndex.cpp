@@ -0,0 +1,176 @@
+// ---------------------------------------------------------------------------
+// FeatureIndex.cpp
+// k-d tree over the shape features of an object database, to find the
+// entries nearest an object without comparing it to every entry.
+// ---------------------------------------------------------------------------
+
+#include "FeatureIndex.h"
+#include <algorithm>
+#include <cmath>
+
+// Changes in each feature counted as one unit of distance: area ratio,
+// perimeter ratio (as compare_to's shape check), ratio of first Hu
+// invariants (a 25% difference) and elongation ratio
+static const double FEATURE_RATIOS[ FeatureIndex::MAX_FEATURES ] = { 1.25, 1.5, 1.0 / 0.75, 1.5 };
+
+// Smallest value a feature is taken to have before its log
+static const double FEATURE_FLOOR = 1e-12;
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Builds the tree over every record of a database.
+// ---------------------------------------------------------------------------
+FeatureIndex::FeatureIndex( const ObjectDatabase& db ) : database( db ), dimensions( MAX_FEATURES ){
+
+	const int entries = (int)db.size();
+
+	for( int e = 0; e < entries; e++ )
+		if( !( db[ e ].flags & RECORD_HAS_DESCRIPTORS ) )
+			dimensions = 1;
+
+	nodes.resize( entries );
+	for( int e = 0; e < entries; e++ ){
+		const ObjectRecord& r = db[ e ];
+		features( (double)r.area, (double)r.perimeter, r.hu[ 0 ], r.hu[ 1 ], dimensions, nodes[ e ].point );
+		nodes[ e ].entry = e;
+	}
+
+	build( 0, entries );
+}
+
+// ---------------------------------------------------------------------------
+// Features
+// Purpose: Scaled feature vector from an object's measurements. The
+//			elongation is the ratio of the principal second moments, which
+//			are ( hu0 +- sqrt( hu1 ) ) / 2.
+// ---------------------------------------------------------------------------
+void FeatureIndex::features( const double area, const double perimeter, const double hu0,
+							 const double hu1, const int dimensions, double* point ){
+
+	point[ 0 ] = log( std::max( area, FEATURE_FLOOR ) ) / log( FEATURE_RATIOS[ 0 ] );
+	if( dimensions == 1 )
+		return;
+
+	const double spread = sqrt( std::max( hu1, 0.0 ) );
+	const double elongation = ( hu0 + spread ) / std::max( hu0 - spread, FEATURE_FLOOR );
+
+	point[ 1 ] = log( std::max( perimeter, FEATURE_FLOOR ) ) / log( FEATURE_RATIOS[ 1 ] );
+	point[ 2 ] = log( std::max( hu0, FEATURE_FLOOR ) ) / log( FEATURE_RATIOS[ 2 ] );
+	point[ 3 ] = log( std::max( elongation, 1.0 ) ) / log( FEATURE_RATIOS[ 3 ] );
+}
+
+// ---------------------------------------------------------------------------
+// Build
+// Purpose: Arranges nodes [ first, last ) into a subtree, split at the
+//			median of the feature they spread most along.
+// ---------------------------------------------------------------------------
+void FeatureIndex::build( const int first, const int last ){
+
+	if( last - first < 2 ){
+		if( first < last )
+			nodes[ first ].axis = 0;
+		return;
+	}
+
+	int axis = 0;
+	double widest = -1;
+	for( int d = 0; d < dimensions; d++ ){
+		double low = nodes[ first ].point[ d ];
+		double high = low;
+		for( int n = first + 1; n < last; n++ ){
+			low = std::min( low, nodes[ n ].point[ d ] );
+			high = std::max( high, nodes[ n ].point[ d ] );
+		}
+		if( high - low > widest ){
+			widest = high - low;
+			axis = d;
+		}
+	}
+
+	const int mid = first + ( last - first ) / 2;
+	std::nth_element( nodes.begin() + first, nodes.begin() + mid, nodes.begin() + last,
+		[ axis ]( const Node& a, const Node& b ){ return a.point[ axis ] < b.point[ axis ]; } );
+	nodes[ mid ].axis = axis;
+
+	build( first, mid );
+	build( mid + 1, last );
+}
+
+// ---------------------------------------------------------------------------
+// Search
+// Purpose: Adds the nodes of subtree [ first, last ) nearer the query than
+//			radius to best, kept nearest first and at most k long. Once best
+//			is full the radius shrinks to its farthest entry, and subtrees
+//			beyond the radius are skipped.
+// ---------------------------------------------------------------------------
+void FeatureIndex::search( const int first, const int last, const double* query, const size_t k,
+						   double& radius2, std::vector< Neighbour >& best ) const{
+
+	if( first >= last )
+		return;
+
+	const int mid = first + ( last - first ) / 2;
+	const Node& node = nodes[ mid ];
+
+	double distance2 = 0;
+	for( int d = 0; d < dimensions; d++ ){
+		const double difference = query[ d ] - node.point[ d ];
+		distance2 += difference * difference;
+	}
+
+	if( distance2 <= radius2 ){
+
+		Neighbour found;
+		found.entry = node.entry;
+		found.distance = distance2; // Squared until the search is over
+
+		std::vector< Neighbour >::iterator at = best.begin();
+		while( at != best.end() && at->distance <= distance2 )
+			at++;
+		best.insert( at, found );
+
+		if( best.size() > k )
+			best.pop_back();
+		if( best.size() == k )
+			radius2 = best.back().distance;
+	}
+
+	// Nearer side first, it's the likelier to shrink the radius
+	const double offset = query[ node.axis ] - node.point[ node.axis ];
+	if( offset < 0 ){
+		search( first, mid, query, k, radius2, best );
+		if( offset * offset <= radius2 )
+			search( mid + 1, last, query, k, radius2, best );
+	}
+	else{
+		search( mid + 1, last, query, k, radius2, best );
+		if( offset * offset <= radius2 )
+			search( first, mid, query, k, radius2, best );
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Nearest
+// Purpose: Finds the entries nearest an object in feature space.
+// ---------------------------------------------------------------------------
+std::vector< Neighbour > FeatureIndex::nearest( const ObjectInfo& object, const int k,
+												const double tolerance ) const{
+
+	std::vector< Neighbour > best;
+	if( k <= 0 || nodes.empty() )
+		return best;
+
+	const ObjectFeatures& f = object.getFeatures();
+
+	double query[ MAX_FEATURES ];
+	features( (double)object.getArea(), (double)object.getPerimeter(), f.hu[ 0 ], f.hu[ 1 ], dimensions, query );
+
+	double radius2 = tolerance * tolerance;
+	best.reserve( k + 1 );
+	search( 0, (int)nodes.size(), query, (size_t)k, radius2, best );
+
+	for( size_t n = 0; n < best.size(); n++ )
+		best[ n ].distance = sqrt( best[ n ].distance );
+
+	return best;
+}
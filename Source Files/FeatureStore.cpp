@@ -0,0 +1,319 @@
+// ---------------------------------------------------------------------------
+// FeatureStore.cpp
+// Shape features of an object database, one contiguous column per feature,
+// scored against an object a batch of entries at a time, with AVX-512,
+// AVX2, SSE2 or plain C++ distance kernels as cpu_level() allows.
+// ---------------------------------------------------------------------------
+
+#include "FeatureStore.h"
+#include "CpuLevel.h"
+#include <cmath>
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Entries scored at a time by nearest(), small enough to stay in L1
+const size_t BATCH = 1024;
+
+// Out[ e ] = sum over d of w[ d ] * ( columns[ d ][ e ] - q[ d ] )^2
+typedef void ( *DistanceKernel )( const float* const* columns, int dimensions, const float* q,
+								  const float* w, size_t length, float* out );
+
+struct Kernels{
+	const char* name;
+	DistanceKernel distance;
+};
+
+// ---------------------------------------------------------------------------
+// Scalar kernel, also used for the tails of the vector kernels
+// ---------------------------------------------------------------------------
+void distance_scalar( const float* const* columns, int dimensions, const float* q,
+					  const float* w, size_t length, float* out ){
+
+	for( size_t e = 0; e < length; e++ ){
+		float sum = 0;
+		for( int d = 0; d < dimensions; d++ ){
+			const float difference = columns[ d ][ e ] - q[ d ];
+			sum += w[ d ] * ( difference * difference );
+		}
+		out[ e ] = sum;
+	}
+}
+
+// Columns advanced past the first e entries, for the tails
+void advance( const float* const* columns, int dimensions, size_t e, const float** moved ){
+
+	for( int d = 0; d < dimensions; d++ )
+		moved[ d ] = columns[ d ] + e;
+}
+
+#ifdef CPU_X86
+
+// ---------------------------------------------------------------------------
+// SSE2 kernel: 4 entries per vector
+// ---------------------------------------------------------------------------
+__attribute__(( target( "sse2" ) ))
+void distance_sse2( const float* const* columns, int dimensions, const float* q,
+					const float* w, size_t length, float* out ){
+
+	size_t e = 0;
+	for( ; e + 4 <= length; e += 4 ){
+		__m128 sum = _mm_setzero_ps();
+		for( int d = 0; d < dimensions; d++ ){
+			const __m128 difference = _mm_sub_ps( _mm_loadu_ps( columns[ d ] + e ), _mm_set1_ps( q[ d ] ) );
+			sum = _mm_add_ps( sum, _mm_mul_ps( _mm_set1_ps( w[ d ] ), _mm_mul_ps( difference, difference ) ) );
+		}
+		_mm_storeu_ps( out + e, sum );
+	}
+
+	const float* tail[ FeatureIndex::MAX_FEATURES ];
+	advance( columns, dimensions, e, tail );
+	distance_scalar( tail, dimensions, q, w, length - e, out + e );
+}
+
+// ---------------------------------------------------------------------------
+// AVX2 kernel: 8 entries per vector
+// ---------------------------------------------------------------------------
+__attribute__(( target( "avx2" ) ))
+void distance_avx2( const float* const* columns, int dimensions, const float* q,
+					const float* w, size_t length, float* out ){
+
+	size_t e = 0;
+	for( ; e + 8 <= length; e += 8 ){
+		__m256 sum = _mm256_setzero_ps();
+		for( int d = 0; d < dimensions; d++ ){
+			const __m256 difference = _mm256_sub_ps( _mm256_loadu_ps( columns[ d ] + e ), _mm256_set1_ps( q[ d ] ) );
+			sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_set1_ps( w[ d ] ), _mm256_mul_ps( difference, difference ) ) );
+		}
+		_mm256_storeu_ps( out + e, sum );
+	}
+
+	const float* tail[ FeatureIndex::MAX_FEATURES ];
+	advance( columns, dimensions, e, tail );
+	distance_scalar( tail, dimensions, q, w, length - e, out + e );
+}
+
+// ---------------------------------------------------------------------------
+// AVX-512 kernel: 16 entries per vector
+// ---------------------------------------------------------------------------
+__attribute__(( target( "avx512f" ) ))
+void distance_avx512( const float* const* columns, int dimensions, const float* q,
+					  const float* w, size_t length, float* out ){
+
+	size_t e = 0;
+	for( ; e + 16 <= length; e += 16 ){
+		__m512 sum = _mm512_setzero_ps();
+		for( int d = 0; d < dimensions; d++ ){
+			const __m512 difference = _mm512_sub_ps( _mm512_loadu_ps( columns[ d ] + e ), _mm512_set1_ps( q[ d ] ) );
+			sum = _mm512_add_ps( sum, _mm512_mul_ps( _mm512_set1_ps( w[ d ] ), _mm512_mul_ps( difference, difference ) ) );
+		}
+		_mm512_storeu_ps( out + e, sum );
+	}
+
+	const float* tail[ FeatureIndex::MAX_FEATURES ];
+	advance( columns, dimensions, e, tail );
+	distance_scalar( tail, dimensions, q, w, length - e, out + e );
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// Select_Kernels
+// Purpose: Picks the widest kernels this CPU can run.
+// ---------------------------------------------------------------------------
+Kernels select_kernels( void ){
+
+#ifdef CPU_X86
+	// Float lanes only need AVX-512F
+	const CpuLevel level = cpu_level();
+
+	if( level >= CPU_AVX512F ){
+		Kernels k = { "avx512", distance_avx512 };
+		return k;
+	}
+	if( level >= CPU_AVX2 ){
+		Kernels k = { "avx2", distance_avx2 };
+		return k;
+	}
+	if( level >= CPU_SSE2 ){
+		Kernels k = { "sse2", distance_sse2 };
+		return k;
+	}
+#endif
+	Kernels k = { "scalar", distance_scalar };
+	return k;
+}
+
+const Kernels& kernels( void ){
+
+	static const Kernels selected = select_kernels();
+	return selected;
+}
+
+}
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Copies the features of every record of a database into columns.
+// ---------------------------------------------------------------------------
+FeatureStore::FeatureStore( const ObjectDatabase& db, const float* feature_weights )
+	: count( db.size() ), dimensions( FeatureIndex::MAX_FEATURES ){
+
+	for( size_t e = 0; e < count; e++ )
+		if( !( db[ e ].flags & RECORD_HAS_DESCRIPTORS ) )
+			dimensions = 1;
+
+	for( int d = 0; d < FeatureIndex::MAX_FEATURES; d++ )
+		weights[ d ] = feature_weights ? feature_weights[ d ] : 1.0f;
+
+	for( int d = 0; d < dimensions; d++ )
+		columns[ d ].resize( count );
+
+	for( size_t e = 0; e < count; e++ ){
+
+		const ObjectRecord& r = db[ e ];
+
+		double point[ FeatureIndex::MAX_FEATURES ];
+		FeatureIndex::features( (double)r.area, (double)r.perimeter, r.hu[ 0 ], r.hu[ 1 ], dimensions, point );
+
+		for( int d = 0; d < dimensions; d++ )
+			columns[ d ][ e ] = (float)point[ d ];
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Query
+// Purpose: Feature vector of an object, in the columns' precision.
+// ---------------------------------------------------------------------------
+void FeatureStore::query( const ObjectInfo& object, float* point ) const{
+
+	const ObjectFeatures& f = object.getFeatures();
+
+	double features[ FeatureIndex::MAX_FEATURES ];
+	FeatureIndex::features( (double)object.getArea(), (double)object.getPerimeter(), f.hu[ 0 ], f.hu[ 1 ], dimensions, features );
+
+	for( int d = 0; d < dimensions; d++ )
+		point[ d ] = (float)features[ d ];
+}
+
+// ---------------------------------------------------------------------------
+// Distances
+// Purpose: Weighted squared feature distances from an object to entries
+//			[ first, first + length ).
+// ---------------------------------------------------------------------------
+void FeatureStore::distances( const ObjectInfo& object, const size_t first, const size_t length,
+							  float* out ) const{
+
+	float point[ FeatureIndex::MAX_FEATURES ];
+	query( object, point );
+
+	const float* batch[ FeatureIndex::MAX_FEATURES ];
+	for( int d = 0; d < dimensions; d++ )
+		batch[ d ] = columns[ d ].data() + first;
+
+	kernels().distance( batch, dimensions, point, weights, length, out );
+}
+
+// ---------------------------------------------------------------------------
+// Nearest
+// Purpose: Scores every entry, a batch at a time, keeping the k nearest
+//			within the tolerance.
+// ---------------------------------------------------------------------------
+std::vector< Neighbour > FeatureStore::nearest( const ObjectInfo& object, const int k,
+												const double tolerance ) const{
+
+	std::vector< Neighbour > best;
+	if( k <= 0 || count == 0 )
+		return best;
+
+	float point[ FeatureIndex::MAX_FEATURES ];
+	query( object, point );
+
+	float scores[ BATCH ];
+	const float* batch[ FeatureIndex::MAX_FEATURES ];
+
+	// Entries farther than the radius can't be kept, it shrinks to the
+	// farthest kept once there are k
+	float radius2 = (float)( tolerance * tolerance );
+	best.reserve( k + 1 );
+
+	for( size_t first = 0; first < count; first += BATCH ){
+
+		const size_t length = ( count - first < BATCH ) ? count - first : BATCH;
+		for( int d = 0; d < dimensions; d++ )
+			batch[ d ] = columns[ d ].data() + first;
+
+		kernels().distance( batch, dimensions, point, weights, length, scores );
+
+		for( size_t e = 0; e < length; e++ ){
+
+			if( !( scores[ e ] <= radius2 ) )
+				continue;
+
+			Neighbour found;
+			found.entry = (int)( first + e );
+			found.distance = scores[ e ];
+
+			std::vector< Neighbour >::iterator at = best.begin();
+			while( at != best.end() && at->distance <= found.distance )
+				at++;
+			best.insert( at, found );
+
+			if( best.size() > (size_t)k )
+				best.pop_back();
+			if( best.size() == (size_t)k )
+				radius2 = (float)best.back().distance;
+		}
+	}
+
+	for( size_t n = 0; n < best.size(); n++ )
+		best[ n ].distance = sqrt( best[ n ].distance );
+
+	return best;
+}
+
+// ---------------------------------------------------------------------------
+// Within
+// Purpose: Scores every entry, a batch at a time, keeping all within the
+//			tolerance.
+// ---------------------------------------------------------------------------
+std::vector< Neighbour > FeatureStore::within( const ObjectInfo& object, const double tolerance ) const{
+
+	std::vector< Neighbour > found;
+
+	float point[ FeatureIndex::MAX_FEATURES ];
+	query( object, point );
+
+	float scores[ BATCH ];
+	const float* batch[ FeatureIndex::MAX_FEATURES ];
+	const float radius2 = (float)( tolerance * tolerance );
+
+	for( size_t first = 0; first < count; first += BATCH ){
+
+		const size_t length = ( count - first < BATCH ) ? count - first : BATCH;
+		for( int d = 0; d < dimensions; d++ )
+			batch[ d ] = columns[ d ].data() + first;
+
+		kernels().distance( batch, dimensions, point, weights, length, scores );
+
+		for( size_t e = 0; e < length; e++ ){
+			if( scores[ e ] <= radius2 ){
+				Neighbour near;
+				near.entry = (int)( first + e );
+				near.distance = sqrt( scores[ e ] );
+				found.push_back( near );
+			}
+		}
+	}
+
+	return found;
+}
+
+// ---------------------------------------------------------------------------
+// Kernel_Name
+// Purpose: Name of the instruction set the kernels run with on this CPU.
+// ---------------------------------------------------------------------------
+const char* FeatureStore::kernel_name( void ){ return kernels().name; }
@@ -4,6 +4,8 @@
 */
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
 #include "Image.h"
 
 Image::Image(){
@@ -12,32 +14,74 @@ Image::Image(){
     Ncols=0;
     Nrows=0;
     Ncolors=0;
+    Nstride=0;
     image=NULL;
+    mapping=NULL;
+    mappingLength=0;
 }
 
 Image::Image(const Image &im){
     /* initialize image class */
     /* Copy from im  */
-  setSize(im.getNRows(), im.getNCols());
+  Ncols=0;
+  Nrows=0;
+  Ncolors=0;
+  Nstride=0;
+  image=NULL;
+  mapping=NULL;
+  mappingLength=0;
+  if (im.getNRows()>0 && im.getNCols()>0)
+    setSize(im.getNRows(), im.getNCols());
   setColors(im.getColors());
-  int i,j;
-  for (i=0; i<getNRows(); ++i)
-    for (j=0; j<getNCols(); ++j){
-      setPixel(i,j, im.getPixel(i,j));
-    }
+  int i;
+  if (image)
+    for (i=0; i<getNRows(); ++i)
+      memcpy(getRow(i), im.getRow(i), getNCols());
 }
 
+Image::Image(Image &&im){
+    /* take over the pixels of im, */
+    /* which is left empty  */
+  Ncols=im.Ncols;
+  Nrows=im.Nrows;
+  Ncolors=im.Ncolors;
+  Nstride=im.Nstride;
+  image=im.image;
+  mapping=im.mapping;
+  mappingLength=im.mappingLength;
+  im.Ncols=0;
+  im.Nrows=0;
+  im.Ncolors=0;
+  im.Nstride=0;
+  im.image=NULL;
+  im.mapping=NULL;
+  im.mappingLength=0;
+}
 
 Image::~Image(){
-    int i;
-    if (image) {
-	for (i=0; i<Nrows; i++)
-	    free( image[i] );
+    release();
+}
+
+/*
+ gives back the pixel buffer: unmaps it if the image is a view
+ of a memory mapping, frees it otherwise.
+*/
+void
+Image::release(){
+    if (mapping)
+	munmap(mapping, mappingLength);
+    else
 	free(image);
-    }
+    image=NULL;
+    mapping=NULL;
+    mappingLength=0;
 }
 /*
  allocates space for an rows x columns image.
+ the pixels are kept in one contiguous buffer; every row starts
+ on an IMAGE_ALIGNMENT boundary, so the row stride is the number
+ of columns rounded up to a multiple of IMAGE_ALIGNMENT. (images
+ made by setMapping keep the mapping's layout, aligned or not.)
 
  returns : -2 if rows or columns <=0
            -1 if cannot allocate space
@@ -48,31 +92,55 @@ Image::~Image(){
 int
 Image::setSize(int rows, int columns)
 {
-    int i;
+    void *buffer;
+    int stride;
     if (rows<=0 || columns <=0){
 	printf("setSize: rows, columns must be positive\n");
 	return -2;
     }
 
-    if ( (image=(int **)malloc(sizeof (int *) * rows))==NULL ){
+    stride=(columns+IMAGE_ALIGNMENT-1)/IMAGE_ALIGNMENT*IMAGE_ALIGNMENT;
+    if ( posix_memalign(&buffer, IMAGE_ALIGNMENT, (size_t)stride * rows)!=0 ){
 	printf("setSize: can't allocate space\n");
 	return -1;
      }
 
-    for (i=0; i<rows; i++) {
-	if ( (image[i]=(int *)malloc(sizeof(int) * columns))==NULL){
-	    printf("setSize: can't allocate space\n");
-	    return -1;
-	}
+    release();
+    image=(unsigned char *)buffer;
+    Nrows=rows;
+    Ncols=columns;
+    Nstride=stride;
+
+    return rows*columns;
+}
+
+/*
+ makes the image a view of pixels inside the memory mapping
+ [base, base+length); nothing is copied.
+
+ returns : -2 if rows or columns <=0
+            rows * columns if success
+*/
+int
+Image::setMapping(unsigned char *pixels, int rows, int columns, int stride,
+		  void *base, size_t length)
+{
+    if (rows<=0 || columns <=0 || stride<columns){
+	printf("setMapping: rows, columns must be positive\n");
+	return -2;
     }
 
+    release();
+    image=pixels;
+    mapping=base;
+    mappingLength=length;
     Nrows=rows;
     Ncols=columns;
+    Nstride=stride;
 
     return rows*columns;
 }
 
-
 /*
  Sets the number of gray - levels
 */
@@ -92,12 +160,12 @@ Image::getPixel(int i, int j)const{
        printf("getPixel: read pixel from an empty image\n");
        return -1;
      }
-  if (i<0 || i>Nrows || j<0 || j>Ncols){
+  if (i<0 || i>=Nrows || j<0 || j>=Ncols){
 //         error_msg("getPixel: out of image");
         return -1;
        }
        else
-          return image[i][j];
+          return image[(long)i*Nstride+j];
 }
 
 /*
@@ -111,11 +179,11 @@ int
        return 0;
      }
 
- if ( i<0 || i>Nrows || j<0 || j>Ncols ){
+ if ( i<0 || i>=Nrows || j<0 || j>=Ncols ){
  //  error_msg("Image::setPixel -> Out of boundaries\n");
    return -1;
  }
- image[i][j]=color;
+ image[(long)i*Nstride+j]=(unsigned char)color;
  return color;
 }
 
@@ -0,0 +1,102 @@
+// ---------------------------------------------------------------------------
+// IntegralImage.cpp
+// Summed-area tables of an image's grey levels and squared grey levels, so
+// the sum over any rectangle takes four lookups.
+// ---------------------------------------------------------------------------
+
+#include "IntegralImage.h"
+#include "Parallel.h"
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Builds the tables, each band of rows on its own thread. Each
+//			band first accumulates as if it started at the top of the image,
+//			then the bands' bottom rows are chained together and every band
+//			adds the total of the bands above it.
+//
+// Parameters:
+//		Parameter 1: Greyscale image
+//		Parameter 2: Also build the table of squared grey levels?
+// ---------------------------------------------------------------------------
+IntegralImage::IntegralImage( const Image& image, const bool with_squares ){
+
+	const int rows = image.getNRows();
+	const int cols = image.getNCols();
+	const int bands = band_count( rows );
+
+	width = cols + 1;
+	sums.assign( (size_t)( rows + 1 ) * width, 0 );
+	if( with_squares )
+		squares.assign( (size_t)( rows + 1 ) * width, 0 );
+
+	// Band local tables, table row i + 1 holds image row i
+	parallel_bands( rows, [ & ]( const int first, const int last, int ){
+
+		for( int i = first; i < last; i++ ){
+
+			const unsigned char* pixels = image.getRow( i );
+			uint64_t* sum = &sums[ (size_t)( i + 1 ) * width ];
+			const uint64_t* above = ( i > first ) ? sum - width : 0;
+
+			uint64_t row_sum = 0;
+			for( int j = 0; j < cols; j++ ){
+				row_sum += pixels[ j ];
+				sum[ j + 1 ] = row_sum + ( above ? above[ j + 1 ] : 0 );
+			}
+
+			if( !with_squares )
+				continue;
+
+			uint64_t* square = &squares[ (size_t)( i + 1 ) * width ];
+			const uint64_t* square_above = ( i > first ) ? square - width : 0;
+
+			uint64_t row_square = 0;
+			for( int j = 0; j < cols; j++ ){
+				row_square += (uint64_t)pixels[ j ] * pixels[ j ];
+				square[ j + 1 ] = row_square + ( square_above ? square_above[ j + 1 ] : 0 );
+			}
+		}
+	}, bands );
+
+	if( bands == 1 )
+		return;
+
+	// Totals of everything above each band, chained through the bands'
+	// bottom rows
+	const int planes = with_squares ? 2 : 1;
+	std::vector< uint64_t > offsets( (size_t)bands * planes * width, 0 );
+
+	for( int b = 1; b < bands; b++ ){
+
+		const int previous_last = (int)( (long)rows * b / bands ); // table row of band b - 1's bottom
+		for( int p = 0; p < planes; p++ ){
+
+			const std::vector< uint64_t >& table = p ? squares : sums;
+			const uint64_t* bottom = &table[ (size_t)previous_last * width ];
+			const uint64_t* previous = &offsets[ ( (size_t)( b - 1 ) * planes + p ) * width ];
+			uint64_t* offset = &offsets[ ( (size_t)b * planes + p ) * width ];
+
+			for( int j = 0; j < width; j++ )
+				offset[ j ] = previous[ j ] + bottom[ j ];
+		}
+	}
+
+	// Add them in
+	parallel_bands( rows, [ & ]( const int first, const int last, const int band ){
+
+		if( band == 0 )
+			return;
+
+		for( int p = 0; p < planes; p++ ){
+
+			std::vector< uint64_t >& table = p ? squares : sums;
+			const uint64_t* offset = &offsets[ ( (size_t)band * planes + p ) * width ];
+
+			for( int i = first; i < last; i++ ){
+				uint64_t* row = &table[ (size_t)( i + 1 ) * width ];
+				for( int j = 0; j < width; j++ )
+					row[ j ] += offset[ j ];
+			}
+		}
+	}, bands );
+}
@@ -8,14 +8,18 @@
 
 #include "LabeledImage.h"
 #include "DisjSets.h"
-#include <set>
+#include "ConcurrentDisjSets.h"
+#include "Parallel.h"
+#include "Assignment.h"
 #include <stdexcept>
-#include <fstream>
 #include <iostream>
 #include <string>
-#include <sstream>
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <utility>
 
 // ---------------------------------------------------------------------------
 // CONSTRUCTOR
@@ -24,11 +28,15 @@
 // Parameters:
 //		Parameter 1: Image file path
 //		Parameter 2: Convert this image?
+//		Parameter 3: Labeling engine to convert with
+//		Parameter 4: Pixel connectivity of objects
+//		Parameter 5: Number objects in raster order with LABEL_PARALLEL?
 // ---------------------------------------------------------------------------
-LabeledImage::LabeledImage( const char* path, bool convert ){
+LabeledImage::LabeledImage( const char* path, bool convert, const LabelingMethod method,
+							const Connectivity connectivity, const bool deterministic ) : object_count( 0 ){
 
-	// Try to read file into this object
-	if( readImage( this, path ) == -1 ){
+	// Try to map file into this object, pixels are only copied if written
+	if( mapImage( this, path ) == -1 ){
 		if( !path )
 			throw std::invalid_argument( "Invalid input file" );
 		
@@ -36,188 +44,959 @@ LabeledImage::LabeledImage( const char* path, bool convert ){
 	}
 
 	// Convert this image?
-	if( convert )
-		two_pass(); // Run two pass sequential labeling algorithm
+	if( convert ){
+		if( connectivity == CONNECTIVITY_8 )
+			label< 8 >( method, deterministic );
+		else
+			label< 4 >( method, deterministic );
+	}
+}
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Constructs a labeled image from a copy of an image in memory.
+//
+// Parameters:
+//		Parameter 1: Image
+//		Parameter 2: Convert this image?
+//		Parameter 3: Labeling engine to convert with
+//		Parameter 4: Pixel connectivity of objects
+//		Parameter 5: Number objects in raster order with LABEL_PARALLEL?
+// ---------------------------------------------------------------------------
+LabeledImage::LabeledImage( const Image& image, bool convert, const LabelingMethod method,
+							const Connectivity connectivity, const bool deterministic ) : Image( image ), object_count( 0 ){
+
+	if( image.getNRows() > 0 && !getData() )
+		throw std::bad_alloc();
+
+	// Convert this image?
+	if( convert ){
+		if( connectivity == CONNECTIVITY_8 )
+			label< 8 >( method, deterministic );
+		else
+			label< 4 >( method, deterministic );
+	}
+}
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Constructs a labeled image from an image in memory, taking over
+//			its pixels instead of copying them.
+//
+// Parameters:
+//		Parameter 1: Image, left empty
+//		Parameter 2: Convert this image?
+//		Parameter 3: Labeling engine to convert with
+//		Parameter 4: Pixel connectivity of objects
+//		Parameter 5: Number objects in raster order with LABEL_PARALLEL?
+// ---------------------------------------------------------------------------
+LabeledImage::LabeledImage( Image&& image, bool convert, const LabelingMethod method,
+							const Connectivity connectivity, const bool deterministic )
+	: Image( std::move( image ) ), object_count( 0 ){
+
+	// Convert this image?
+	if( convert ){
+		if( connectivity == CONNECTIVITY_8 )
+			label< 8 >( method, deterministic );
+		else
+			label< 4 >( method, deterministic );
+	}
+}
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Constructs a labeled image from a packed binary image, labeling
+//			it without unpacking.
+//
+// Parameters:
+//		Parameter 1: Packed binary image
+//		Parameter 2: Labeling engine to convert with
+//		Parameter 3: Pixel connectivity of objects
+//		Parameter 4: Number objects in raster order with LABEL_PARALLEL?
+// ---------------------------------------------------------------------------
+LabeledImage::LabeledImage( const PackedBinaryImage& binary, const LabelingMethod method,
+							const Connectivity connectivity, const bool deterministic ) : object_count( 0 ){
+
+	if( setSize( binary.getNRows(), binary.getNCols() ) < 0 )
+		throw std::bad_alloc();
+
+	// Start with an all background image
+	for( int i = 0; i < getNRows(); i++ )
+		memset( getRow( i ), 0, getNCols() );
+
+	if( connectivity == CONNECTIVITY_8 )
+		label< 8 >( binary, method, deterministic );
+	else
+		label< 4 >( binary, method, deterministic );
 }
 
 LabeledImage::~LabeledImage( void ){ }
 
+// ---------------------------------------------------------------------------
+// Label
+// Purpose: Labels this binary image with the engine given.
+// ---------------------------------------------------------------------------
+template< int C >
+void LabeledImage::label( const LabelingMethod method, const bool deterministic ){
+
+	switch( method ){
+		case LABEL_RUN_LENGTH:
+			runs = RunLengthImage( *this );
+			run_length< C >( runs ); // Label runs of foreground pixels
+			break;
+		case LABEL_BLOCK:
+			block_based< C >(); // Label blocks of pixels
+			break;
+		case LABEL_PARALLEL:
+			strip_parallel< C, Image >( *this, deterministic ); // Label strips on their own threads
+			break;
+		case LABEL_MOMENTS:
+			two_pass< C, true >(); // Two pass labeling, also measuring objects
+			break;
+		default:
+			two_pass< C, false >(); // Run two pass sequential labeling algorithm
+			break;
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Label
+// Purpose: Labels a packed binary image into this all background image.
+// ---------------------------------------------------------------------------
+template< int C >
+void LabeledImage::label( const PackedBinaryImage& binary, const LabelingMethod method,
+						  const bool deterministic ){
+
+	switch( method ){
+		case LABEL_RUN_LENGTH:
+			runs = RunLengthImage( binary );
+			run_length< C >( runs );
+			break;
+		case LABEL_BLOCK:
+			// Blocks read whole bytes, so this one engine unpacks
+			binary.unpack( *this );
+			block_based< C >();
+			break;
+		case LABEL_PARALLEL:
+			strip_parallel< C >( binary, deterministic );
+			break;
+		case LABEL_MOMENTS:
+			two_pass< C, true >( binary );
+			break;
+		default:
+			two_pass< C, false >( binary );
+			break;
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Number_Objects
+// Purpose: Resolves label equivalences into object numbers. Provisional
+//			labels are handed out in raster order, so walking them in order
+//			numbers objects 1, 2, ... in the order they first appear.
+//
+// Parameters:
+//		1: Label equivalences, one set per provisional label, set 0 unused
+//		2: Out: number of objects
+// Returns: Object number of each provisional label
+// ---------------------------------------------------------------------------
+static std::vector< int > number_objects( DisjSets& disjSets, int& total_objects ){
+
+	const int label_count = disjSets.size() - 1;
+
+	// Object number of each set representative, 0 until its object is seen
+	std::vector< int > object_of_set( label_count + 1, 0 );
+
+	// Object number of each provisional label
+	std::vector< int > object_number( label_count + 1, 0 );
+
+	total_objects = 0;
+	for( int label = 1; label <= label_count; label++ ){
+
+		int& object = object_of_set[ disjSets.find( label ) ];
+		if( object == 0 )
+			object = ++total_objects;
+
+		object_number[ label ] = object;
+	}
+
+	return object_number;
+}
+
+// ---------------------------------------------------------------------------
+// Merge_Label
+// Purpose: Gives a pixel (or run, or block) the label of a connected
+//			neighbour, or merges the neighbour's label with the one it
+//			already has.
+//
+// Parameters:
+//		1: Label so far, 0 if none yet
+//		2: Label of a connected neighbour
+//		3: Label equivalences
+// ---------------------------------------------------------------------------
+static inline void merge_label( int& label, const int neighbor, DisjSets& disjSets ){
+
+	// Take the label of the first neighbour...
+	if( label == 0 )
+		label = neighbor;
+
+	// ...and merge the others with it
+	else if( neighbor != label ){
+
+		// Get set representatives
+		const int f1 = disjSets.find( std::max( label, neighbor ) );
+		const int f2 = disjSets.find( std::min( label, neighbor ) );
+
+		// If set representatives aren't the same
+		// Create a Union between the set reps of the neighbors
+		if( f1 != f2 )
+			disjSets.unionSets( f1, f2 );
+
+		// Take smallest label...
+		label = std::min( label, neighbor );
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Label_Pixel
+// Purpose: First pass step for one foreground pixel. Gives it the label of
+//			its foreground neighbours already scanned (West, North, and with
+//			8 way connectivity North West and North East), merging them when
+//			there are several, or a new label when there are none.
+//
+// Parameters:
+//		1: Provisional labels of the pixel's row
+//		2: Provisional labels of the row above
+//		3: Column
+//		4: Is the North neighbour foreground?
+//		5: Is the West neighbour foreground?
+//		6: Is the North West neighbour foreground? (8 way only)
+//		7: Is the North East neighbour foreground? (8 way only)
+//		8: Label equivalences, grows by one set per new label
+// ---------------------------------------------------------------------------
+template< int C >
+static inline void label_pixel( int* labels, const int* labels_above, const int j,
+								const bool north, const bool west,
+								const bool north_west, const bool north_east,
+								DisjSets& disjSets ){
+
+	int label = 0;
+
+	if( north )
+		merge_label( label, labels_above[ j ], disjSets );
+	if( west )
+		merge_label( label, labels[ j-1 ], disjSets );
+	if( C == 8 && north_west )
+		merge_label( label, labels_above[ j-1 ], disjSets );
+	if( C == 8 && north_east )
+		merge_label( label, labels_above[ j+1 ], disjSets );
+
+	// No neighbors, give it a new label
+	labels[ j ] = label ? label : disjSets.makeSet();
+}
+
 // ---------------------------------------------------------------------------
 // Two_Pass
 // Purpose: Labels objects in a binary image with varying grey levels. 
+//			With Moments, the area and moments of each provisional label
+//			are accumulated in the first pass too.
 // ---------------------------------------------------------------------------
+template< int C, bool Moments >
 void LabeledImage::two_pass( void ){
 
 	// Cache rows & columns
 	const int current_rows = getNRows();
 	const int current_cols = getNCols();
 
-	// Vector for labels of dimensions [rows][columns]
-	std::vector< std::vector<int> > labels(
-		current_rows,
-		std::vector<int>(current_cols, 0));
+	// Provisional labels, one flat rows x columns buffer
+	std::vector< int > labels( (size_t)current_rows * current_cols, 0 );
 
-	// Create disjoint sets
-	DisjSets disjSets( current_rows * current_cols );
+	// Label equivalences, one set per provisional label handed out.
+	// Set 0 stands for the background and is never used
+	DisjSets disjSets( 1 );
 
-	// Current label
-	int current_label = 1;
+	// Area and moments of each provisional label
+	std::vector< ObjectInfo > label_moments( Moments ? 1 : 0 );
 
 	// First pass
 	for ( int i = 0; i < current_rows; i++ ){
+
+		const unsigned char* pixels = getRow( i );
+		const unsigned char* pixels_above = ( i > 0 ) ? getRow( i - 1 ) : 0;
+		int* row_labels = &labels[ (size_t)i * current_cols ];
+		const int* row_labels_above = ( i > 0 ) ? row_labels - current_cols : 0;
+
 		for( int j = 0; j < current_cols; j++ ){
 			
-			const int pixel_value = getPixel( i, j );
+			if( pixels[ j ] != 0 ){
 
-			if( pixel_value != 0 ){
+				// Only check pixels already scanned
+				// (West, North, North West & North East)
+				const bool north = ( i > 0 ) && pixels_above[ j ] != 0;
+				const bool west = ( j > 0 ) && pixels[ j - 1 ] != 0;
+				const bool north_west = C == 8 && i > 0 && j > 0 && pixels_above[ j - 1 ] != 0;
+				const bool north_east = C == 8 && i > 0 && j + 1 < current_cols && pixels_above[ j + 1 ] != 0;
 
-				// 4 way connectivity
-				// Only check left and up (West & North)
-				const int neighbor1 = ( i > 0 ) ? getPixel( i - 1, j ) 
-											    : 0;
-				const int neighbor2 = ( j > 0 ) ? getPixel( i, j - 1 ) 
-										        : 0;
+				label_pixel< C >( row_labels, row_labels_above, j, north, west, north_west, north_east, disjSets );
 
-				if( neighbor1 != 0 
-					&& neighbor2 == 0 ){
+				if( Moments ){
 
-					// Take label of left pixel
-					labels[ i ][ j ] = labels[ i-1 ][ j ];
-				}
-				else if( neighbor1 == 0 
-					&& neighbor2 != 0 ){
+					// Edges to background neighbours make up the perimeter
+					const bool south = ( i + 1 < current_rows ) && getRow( i + 1 )[ j ] != 0;
+					const bool east = ( j + 1 < current_cols ) && pixels[ j + 1 ] != 0;
+					const int edges = 4 - north - west - south - east;
 
-					// Take label of upper pixel
-					labels[ i ][ j ] = labels[ i ][ j-1 ];
+					if( row_labels[ j ] == (int)label_moments.size() )
+						label_moments.push_back( ObjectInfo() );
+					label_moments[ row_labels[ j ] ].addPixel( i, j, edges );
 				}
-				else if( neighbor1 != 0 
-					&& neighbor2 != 0 ){
-
-					// Get neighbors
-					int min_label = std::min( labels[ i-1 ][ j ], labels[ i ][ j-1 ] );
-					int max_label = std::max( labels[ i-1 ][ j ], labels[ i ][ j-1 ] );
-
-					// If neighbors aren't equivalent
-					if( labels[ i ][ j-1 ] != labels[ i-1 ][ j ] )
-					{
-						// Get set representatives
-						int f1 = disjSets.find( max_label );
-						int f2 = disjSets.find( min_label );
-
-						// If set representatives aren't the same
-						// Create a Union between the set reps of the neighbors
-						if( f1 != f2 )
-							disjSets.unionSets( f1, f2 );
-					}
-
-					// Take smallest label...
-					labels[ i ][ j ] = min_label;
+			}
+		}
+	}
+
+	// Second pass
+	resolve_labels( labels, disjSets, Moments ? &label_moments : 0 );
+}
+
+// ---------------------------------------------------------------------------
+// Two_Pass
+// Purpose: Labels objects in a packed binary image. The first pass walks
+//			runs of foreground bits, so background words are skipped whole.
+//			With Moments, the area and moments of each provisional label
+//			are accumulated in the first pass too.
+// ---------------------------------------------------------------------------
+template< int C, bool Moments >
+void LabeledImage::two_pass( const PackedBinaryImage& binary ){
+
+	// Cache rows & columns
+	const int current_rows = getNRows();
+	const int current_cols = getNCols();
+
+	// Provisional labels, one flat rows x columns buffer
+	std::vector< int > labels( (size_t)current_rows * current_cols, 0 );
+
+	// Label equivalences, one set per provisional label handed out.
+	// Set 0 stands for the background and is never used
+	DisjSets disjSets( 1 );
+
+	// Area and moments of each provisional label
+	std::vector< ObjectInfo > label_moments( Moments ? 1 : 0 );
+
+	// First pass, one run of foreground pixels at a time
+	for ( int i = 0; i < current_rows; i++ ){
+
+		int* row_labels = &labels[ (size_t)i * current_cols ];
+		const int* row_labels_above = ( i > 0 ) ? row_labels - current_cols : 0;
+
+		int start = 0, end = 0;
+		while( binary.next_run( i, start, end ) ){
+			for( int j = start; j < end; j++ ){
+
+				// The West neighbour is foreground everywhere in the run
+				// but at its start
+				const bool north = ( i > 0 ) && binary.getPixel( i - 1, j );
+				const bool west = ( j > start );
+				const bool north_west = C == 8 && i > 0 && j > 0 && binary.getPixel( i - 1, j - 1 );
+				const bool north_east = C == 8 && i > 0 && j + 1 < current_cols && binary.getPixel( i - 1, j + 1 );
+
+				label_pixel< C >( row_labels, row_labels_above, j, north, west, north_west, north_east, disjSets );
+
+				if( Moments ){
+
+					// Edges to background neighbours make up the perimeter
+					const bool south = ( i + 1 < current_rows ) && binary.getPixel( i + 1, j );
+					const bool east = ( j + 1 < end );
+					const int edges = 4 - north - west - south - east;
+
+					if( row_labels[ j ] == (int)label_moments.size() )
+						label_moments.push_back( ObjectInfo() );
+					label_moments[ row_labels[ j ] ].addPixel( i, j, edges );
 				}
-				// No neighbors, give it a new label
-				else
-					labels[ i ][ j ] = current_label++;
 			}
+			start = end;
 		}
 	}
 
-	// Create set to count total number of objects
-	// This is needed in order to call the setColors() method
-	std::set< int > total_objects;
+	// Second pass
+	resolve_labels( labels, disjSets, Moments ? &label_moments : 0 );
+}
+
+// ---------------------------------------------------------------------------
+// Resolve_Labels
+// Purpose: Second pass of the labeling. Replaces every provisional label
+//			with the number of its object, in place, and the buffer becomes
+//			the label plane. Pixels get the grey level of their object.
+//
+//			Equivalences are resolved once up front into a table from
+//			provisional label to object number, so the pass itself is one
+//			lookup per pixel.
+//
+// Parameters:
+//		1: Provisional labels from the first pass, 0 for background
+//		2: Label equivalences from the first pass, one set per label
+//		3: Area and moments of each provisional label, or null. Summed
+//		   into the objects get_objects() returns
+// ---------------------------------------------------------------------------
+void LabeledImage::resolve_labels( std::vector< int >& labels, DisjSets& disjSets,
+								   const std::vector< ObjectInfo >* label_moments ){
+
+	// Cache rows & columns
+	const int current_rows = getNRows();
+	const int current_cols = getNCols();
+
+	// Object number of each provisional label
+	int total_objects;
+	const std::vector< int > object_number = number_objects( disjSets, total_objects );
+
+	// Sum the parts of each object measured under different labels
+	if( label_moments ){
+		measured_objects.assign( total_objects + 1, ObjectInfo() );
+		for( int label = 1; label < (int)label_moments->size(); label++ )
+			measured_objects[ object_number[ label ] ].add( ( *label_moments )[ label ] );
+	}
 
 	// Second pass
 	for ( int i = 0; i < current_rows; i++ ){
-		for( int j = 0; j < current_cols; j++ ){
-			
-			if( getPixel( i, j ) != 0 ) {
 
-				// Get set representative for the pixel
-				const int set = disjSets.find( labels[ i ][ j ] );
-				
-				total_objects.insert( set ); // Get unique labels/sets
+		int* row_labels = &labels[ (size_t)i * current_cols ];
+		unsigned char* pixels = getRow( i );
 
-				// Color pixel based off of index in the unique set,
-				// in order to guarantee a unique color for up to 255 objects
-				setPixel( i, j, std::distance( total_objects.begin(), total_objects.find( set ) ) + 1 ); 
+		for( int j = 0; j < current_cols; j++ ){
+			
+			// Object number in the label plane, and its grey level in the
+			// image
+			if( row_labels[ j ] != 0 ){
+				row_labels[ j ] = object_number[ row_labels[ j ] ];
+				pixels[ j ] = get_grey_level( row_labels[ j ] );
 			}
 		}
 	}
-	
+
+	label_plane.swap( labels );
+	finish_labels( total_objects );
+}
+
+// ---------------------------------------------------------------------------
+// Finish_Labels
+// Purpose: Records the number of objects found. Grey levels go up to 255
+//			however many objects there are, see get_grey_level().
+// ---------------------------------------------------------------------------
+void LabeledImage::finish_labels( const int total_objects ){
+
+	object_count = total_objects;
+
 	// Set image colors to number of unique objects
 	// This is set in order to differentiate greylevels betwen image objects
-	setColors( total_objects.size() ); 
+	setColors( std::min( total_objects, 255 ) );
 }
 
 // ---------------------------------------------------------------------------
-// Get_Objects
-// Purpose: Gets all the unique objects from the image.
+// Touch_Reach
+// Purpose: Runs of neighbouring rows touch if they share a column, or with 8
+//			way connectivity if they are one column apart: run a touches run b
+//			when a.end + reach > b.start and a.start < b.end + reach.
 // ---------------------------------------------------------------------------
-std::map< int, ObjectInfo > LabeledImage::get_objects( void ) const{
+template< int C >
+static inline int touch_reach( void ){ return ( C == 8 ) ? 1 : 0; }
+
+// ---------------------------------------------------------------------------
+// Label_Runs
+// Purpose: First pass step for one row of runs. Gives each run the label of
+//			the runs it touches in the row above, merging them when there are
+//			several, or a new label when there are none.
+//
+// Parameters:
+//		1: Runs, rows above row i already labeled
+//		2: Row
+//		3: Label equivalences, grows by one set per new label
+// ---------------------------------------------------------------------------
+template< int C >
+static void label_runs( RunLengthImage& encoded, const int i, DisjSets& disjSets ){
 
-	const double rows = getNRows();
-	const double cols = getNCols();
+	const int reach = touch_reach< C >();
 
-	// Create map of label -> object info
-	std::map< int, ObjectInfo > objects;
-	
-	// Raster Scan
-	int current_label = 0;
-	for ( int i = 0; i < rows; i++ ){
-		for ( int j = 0; j < cols; j++ ){
-			
-			current_label = getPixel( i , j );
-			
-			if( current_label ){
+	const Run* above = ( i > 0 ) ? encoded.begin( i - 1 ) : 0;
+	const Run* above_end = ( i > 0 ) ? encoded.end( i - 1 ) : 0;
+
+	for( Run* run = encoded.begin( i ); run != encoded.end( i ); run++ ){
 
-				ObjectInfo& obj = objects[ current_label ];
+		// Skip runs above that end before this one starts. The last one
+		// touching this run may touch the next run too, so stay on it
+		while( above != above_end && above->end + reach <= run->start )
+			above++;
 
-				// Update EEj, EEj2, EEi, EEi2, EEij, and area
-				obj.area++;
-				obj.eei += i;
-				obj.eej += j;
-				obj.eei2 += ( i * i );
-				obj.eej2 += ( j * j );
-				obj.eeij += ( i * j );
+		run->label = 0;
+		for( const Run* a = above; a != above_end && a->start < run->end + reach; a++ )
+			merge_label( run->label, a->label, disjSets );
+
+		// No neighbors, give it a new label
+		if( run->label == 0 )
+			run->label = disjSets.makeSet();
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Run_Length
+// Purpose: Labels objects by runs of foreground pixels. Runs of a row are
+//			merged with the runs they touch in the row above, so union-find
+//			work is per run instead of per pixel, and each run is written
+//			out with one fill.
+//
+// Parameters:
+//		1: Runs of the binary image, labeled in place
+// ---------------------------------------------------------------------------
+template< int C >
+void LabeledImage::run_length( RunLengthImage& encoded ){
+
+	const int current_rows = encoded.getNRows();
+
+	// Label equivalences, one set per provisional label handed out.
+	// Set 0 stands for the background and is never used
+	DisjSets disjSets( 1 );
+
+	// First pass, provisional labels for runs
+	for( int i = 0; i < current_rows; i++ )
+		label_runs< C >( encoded, i, disjSets );
+
+	// Object number of each provisional label
+	int total_objects;
+	const std::vector< int > object_number = number_objects( disjSets, total_objects );
+
+	// Second pass, one fill per run
+	const int current_cols = getNCols();
+	label_plane.assign( (size_t)current_rows * current_cols, 0 );
+	for( int i = 0; i < current_rows; i++ ){
+
+		unsigned char* pixels = getRow( i );
+		int* row_labels = &label_plane[ (size_t)i * current_cols ];
+		for( Run* run = encoded.begin( i ); run != encoded.end( i ); run++ ){
+			run->label = object_number[ run->label ];
+			memset( pixels + run->start, get_grey_level( run->label ), run->end - run->start );
+			std::fill( row_labels + run->start, row_labels + run->end, run->label );
+		}
+	}
+
+	finish_labels( total_objects );
+}
+
+// ---------------------------------------------------------------------------
+// Strip_Parallel
+// Purpose: Labels objects by runs, each horizontal strip of the image on its
+//			own thread with its own provisional labels. Labels of runs that
+//			touch across strip boundaries are then merged, every boundary
+//			at once through lock-free union-find, and the strips are written
+//			out in parallel again.
+//
+//			Provisional labels of strip b are offset past those of strips
+//			above it, so walking labels in order still meets objects in
+//			raster order. Deterministic numbering does that walk, giving
+//			exactly the objects numbers of the sequential engines; otherwise
+//			each strip numbers the objects it owns from a shared counter.
+//
+// Parameters:
+//		1: Binary image, this image or a packed one
+//		2: Number objects in raster order?
+// ---------------------------------------------------------------------------
+template< int C, typename Source >
+void LabeledImage::strip_parallel( const Source& binary, const bool deterministic ){
+
+	const int current_rows = getNRows();
+	const int strips = band_count( current_rows );
+	const int reach = touch_reach< C >();
+
+	// Runs of each strip, labeled with the strip's provisional labels
+	std::vector< RunLengthImage > strip_runs( strips );
+
+	// Set representative in the strip of each of the strip's labels
+	std::vector< std::vector< int > > strip_roots( strips );
+
+	// First pass, each strip on its own thread
+	parallel_bands( current_rows, [ & ]( const int first, const int last, const int strip ){
+
+		RunLengthImage& encoded = strip_runs[ strip ];
+		encoded = RunLengthImage( binary, first, last );
+
+		DisjSets disjSets( 1 );
+		for( int i = 0; i < encoded.getNRows(); i++ )
+			label_runs< C >( encoded, i, disjSets );
+
+		std::vector< int >& roots = strip_roots[ strip ];
+		roots.resize( disjSets.size() );
+		for( int l = 0; l < disjSets.size(); l++ )
+			roots[ l ] = disjSets.find( l );
+	}, strips );
+
+	// Global label of label 0 of each strip
+	std::vector< int > offset( strips + 1, 0 );
+	for( int b = 0; b < strips; b++ )
+		offset[ b + 1 ] = offset[ b ] + (int)strip_roots[ b ].size() - 1;
+	const int label_count = offset[ strips ];
+
+	// Merge labels of runs touching across strip boundaries, each strip
+	// with the last row of the strip above it
+	ConcurrentDisjSets merged( label_count + 1 );
+
+	parallel_bands( current_rows, [ & ]( int, int, const int b ){
+
+		if( b == 0 )
+			return;
+
+		const RunLengthImage& top = strip_runs[ b - 1 ];
+		const Run* above = top.begin( top.getNRows() - 1 );
+		const Run* above_end = top.end( top.getNRows() - 1 );
+
+		for( const Run* run = strip_runs[ b ].begin( 0 ); run != strip_runs[ b ].end( 0 ); run++ ){
+
+			while( above != above_end && above->end + reach <= run->start )
+				above++;
+
+			for( const Run* a = above; a != above_end && a->start < run->end + reach; a++ )
+				merged.unionSets( offset[ b ] + strip_roots[ b ][ run->label ],
+								  offset[ b - 1 ] + strip_roots[ b - 1 ][ a->label ] );
+		}
+	}, strips );
+
+	// Set representative of each global label, and with non-deterministic
+	// numbering an object number for each representative
+	std::vector< int > set_of_label( label_count + 1, 0 );
+	std::vector< int > object_of_set( label_count + 1, 0 );
+	std::atomic< int > counter( 0 );
+
+	parallel_bands( current_rows, [ & ]( int, int, const int strip ){
+
+		const std::vector< int >& roots = strip_roots[ strip ];
+		for( int l = 1; l < (int)roots.size(); l++ ){
+
+			const int label = offset[ strip ] + l;
+			set_of_label[ label ] = merged.find( offset[ strip ] + roots[ l ] );
+
+			if( !deterministic && set_of_label[ label ] == label )
+				object_of_set[ label ] = ++counter;
+		}
+	}, strips );
+
+	int total_objects = counter;
+	if( deterministic ){
+		for( int label = 1; label <= label_count; label++ ){
+			int& object = object_of_set[ set_of_label[ label ] ];
+			if( object == 0 )
+				object = ++total_objects;
+		}
+	}
+
+	// Second pass, each strip on its own thread
+	const int current_cols = getNCols();
+	label_plane.assign( (size_t)current_rows * current_cols, 0 );
+
+	parallel_bands( current_rows, [ & ]( const int first, int, const int strip ){
+
+		RunLengthImage& encoded = strip_runs[ strip ];
+		for( int i = 0; i < encoded.getNRows(); i++ ){
+
+			unsigned char* pixels = getRow( first + i );
+			int* row_labels = &label_plane[ (size_t)( first + i ) * current_cols ];
+			for( Run* run = encoded.begin( i ); run != encoded.end( i ); run++ ){
+				run->label = object_of_set[ set_of_label[ offset[ strip ] + run->label ] ];
+				memset( pixels + run->start, get_grey_level( run->label ), run->end - run->start );
+				std::fill( row_labels + run->start, row_labels + run->end, run->label );
 			}
 		}
+	}, strips );
+
+	finish_labels( total_objects );
+}
+
+// ---------------------------------------------------------------------------
+// Block labeling
+//
+// The image is scanned in blocks that are always connected inside: 2x2
+// blocks with 8 way connectivity (in the style of Grana's BBDT) and 2x1
+// column pairs with 4 way connectivity. Each block X only looks at the
+// pixels of its neighbour blocks that can touch it:
+//
+//		8 way:	h | i j | k		4 way:	h i
+//				--+-----+--				--+--
+//				n | o p				n | o
+//				r | s t				r | s
+//
+//		P = block holding h, Q = block holding i and j, R = block holding k,
+//		S = block holding n and r.
+//
+// For every combination of those pixels a table, built once, says whether
+// X is foreground and which neighbour blocks it has to take labels from.
+// Neighbours already known to be connected through the pixels read (e.g.
+// h and i both set joins P and Q) are dropped from the table entry, so the
+// scan does no branching on connectivity and fewer unions.
+// ---------------------------------------------------------------------------
+
+// Bits of a block table entry
+enum{
+	BLOCK_FOREGROUND = 1,
+	BLOCK_P = 2,
+	BLOCK_Q = 4,
+	BLOCK_R = 8,
+	BLOCK_S = 16
+};
+
+// Bits of a block table index
+enum{
+	PIXEL_O = 1, PIXEL_P = 2, PIXEL_S = 4, PIXEL_T = 8,
+	PIXEL_H = 16, PIXEL_I = 32, PIXEL_J = 64, PIXEL_K = 128,
+	PIXEL_N = 256, PIXEL_R = 512
+};
+
+// ---------------------------------------------------------------------------
+// Block_Action
+// Purpose: Works out the table entry for one combination of pixels.
+// ---------------------------------------------------------------------------
+template< int C >
+static unsigned char block_action( const int index ){
+
+	const bool o = index & PIXEL_O, p = index & PIXEL_P, s = index & PIXEL_S, t = index & PIXEL_T;
+	const bool h = index & PIXEL_H, i = index & PIXEL_I, j = index & PIXEL_J, k = index & PIXEL_K;
+	const bool n = index & PIXEL_N, r = index & PIXEL_R;
+
+	unsigned char action = 0;
+
+	if( C == 8 ){
+
+		if( !( o || p || s || t ) )
+			return 0;
+		action = BLOCK_FOREGROUND;
+
+		const bool to_p = o && h;
+		const bool to_q = ( o || p ) && ( i || j );
+		const bool to_r = p && k;
+		const bool to_s = ( o || s ) && ( n || r );
+
+		// Neighbours already connected to each other through pixels read
+		const bool pq = h && i, qr = j && k, ps = h && n, qs = i && n;
+
+		if( to_q ) action |= BLOCK_Q;
+		if( to_p && !( to_q && pq ) ) action |= BLOCK_P;
+		if( to_r && !( to_q && qr ) ) action |= BLOCK_R;
+		if( to_s && !( to_q && qs ) && !( to_p && ps ) ) action |= BLOCK_S;
 	}
+	else{
+
+		if( !( o || s ) )
+			return 0;
+		action = BLOCK_FOREGROUND;
+
+		const bool to_q = o && i;
+		const bool to_s = ( o && n ) || ( s && r );
+
+		// Q and S already connected through h
+		const bool qs = h && i && n;
+
+		if( to_q ) action |= BLOCK_Q;
+		if( to_s && !( to_q && qs ) ) action |= BLOCK_S;
+	}
+
+	return action;
+}
+
+// ---------------------------------------------------------------------------
+// Make_Block_Table
+// Purpose: Builds the table of block actions, indexed by neighbourhood.
+// ---------------------------------------------------------------------------
+template< int C >
+static std::vector< unsigned char > make_block_table( void ){
+
+	std::vector< unsigned char > table( 2 * PIXEL_R );
+	for( int index = 0; index < 2 * PIXEL_R; index++ )
+		table[ index ] = block_action< C >( index );
+	return table;
+}
+
+// ---------------------------------------------------------------------------
+// Block_Table
+// Purpose: Table of block actions, built on first use. Threads labeling at
+//			once wait for the one building it.
+// ---------------------------------------------------------------------------
+template< int C >
+static const std::vector< unsigned char >& block_table( void ){
+
+	static const std::vector< unsigned char > table = make_block_table< C >();
+	return table;
+}
+
+// ---------------------------------------------------------------------------
+// Block_Pixel
+// Purpose: Is a pixel foreground? Pixels outside the image are not.
+// ---------------------------------------------------------------------------
+static inline int block_pixel( const unsigned char* row, const int j, const int cols ){
+
+	return ( row && j >= 0 && j < cols && row[ j ] ) ? 1 : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Block_Based
+// Purpose: Labels objects a block of pixels at a time.
+// ---------------------------------------------------------------------------
+template< int C >
+void LabeledImage::block_based( void ){
+
+	const int current_rows = getNRows();
+	const int current_cols = getNCols();
+
+	// Block size
+	const int block_width = ( C == 8 ) ? 2 : 1;
+	const int block_rows = ( current_rows + 1 ) / 2;
+	const int block_cols = ( current_cols + block_width - 1 ) / block_width;
+
+	const unsigned char* table = &block_table< C >()[ 0 ];
+
+	// Provisional label of each block, 0 for background
+	std::vector< int > labels( (size_t)block_rows * block_cols, 0 );
+
+	// Label equivalences, one set per provisional label handed out.
+	// Set 0 stands for the background and is never used
+	DisjSets disjSets( 1 );
+
+	// First pass, one block at a time
+	for( int bi = 0; bi < block_rows; bi++ ){
+
+		const int i = 2 * bi;
+		const unsigned char* above = ( i > 0 ) ? getRow( i - 1 ) : 0;
+		const unsigned char* top = getRow( i );
+		const unsigned char* bottom = ( i + 1 < current_rows ) ? getRow( i + 1 ) : 0;
 
+		int* block_labels = &labels[ (size_t)bi * block_cols ];
+		const int* block_labels_above = ( bi > 0 ) ? block_labels - block_cols : 0;
+
+		for( int bj = 0; bj < block_cols; bj++ ){
+
+			const int j = bj * block_width;
+
+			int index = block_pixel( top, j, current_cols ) * PIXEL_O
+					  | block_pixel( bottom, j, current_cols ) * PIXEL_S
+					  | block_pixel( above, j - 1, current_cols ) * PIXEL_H
+					  | block_pixel( above, j, current_cols ) * PIXEL_I
+					  | block_pixel( top, j - 1, current_cols ) * PIXEL_N
+					  | block_pixel( bottom, j - 1, current_cols ) * PIXEL_R;
+			if( C == 8 )
+				index |= block_pixel( top, j + 1, current_cols ) * PIXEL_P
+					   | block_pixel( bottom, j + 1, current_cols ) * PIXEL_T
+					   | block_pixel( above, j + 1, current_cols ) * PIXEL_J
+					   | block_pixel( above, j + 2, current_cols ) * PIXEL_K;
+
+			const unsigned char action = table[ index ];
+			if( !action )
+				continue;
+
+			int label = 0;
+			if( action & BLOCK_Q )
+				merge_label( label, block_labels_above[ bj ], disjSets );
+			if( action & BLOCK_P )
+				merge_label( label, block_labels_above[ bj - 1 ], disjSets );
+			if( action & BLOCK_R )
+				merge_label( label, block_labels_above[ bj + 1 ], disjSets );
+			if( action & BLOCK_S )
+				merge_label( label, block_labels[ bj - 1 ], disjSets );
+
+			// No neighbors, give it a new label
+			block_labels[ bj ] = label ? label : disjSets.makeSet();
+		}
+	}
+
+	// Set representative of each provisional label
+	const int label_count = disjSets.size() - 1;
+	std::vector< int > set_of_label( label_count + 1, 0 );
+	for( int l = 1; l <= label_count; l++ )
+		set_of_label[ l ] = disjSets.find( l );
+
+	// Blocks are labeled two rows at a time, so number objects by their
+	// first pixel in raster order while writing them out
+	std::vector< int > object_of_set( label_count + 1, 0 );
+	int total_objects = 0;
+
+	// Second pass
+	label_plane.assign( (size_t)current_rows * current_cols, 0 );
+	for( int i = 0; i < current_rows; i++ ){
+
+		unsigned char* pixels = getRow( i );
+		int* row_labels = &label_plane[ (size_t)i * current_cols ];
+		const int* block_labels = &labels[ (size_t)( i / 2 ) * block_cols ];
+
+		for( int j = 0; j < current_cols; j++ ){
+
+			if( pixels[ j ] != 0 ){
+
+				int& object = object_of_set[ set_of_label[ block_labels[ j / block_width ] ] ];
+				if( object == 0 )
+					object = ++total_objects;
+
+				row_labels[ j ] = object;
+				pixels[ j ] = get_grey_level( object );
+			}
+		}
+	}
+
+	finish_labels( total_objects );
+}
+
+// ---------------------------------------------------------------------------
+// Get_Object_Table
+// Purpose: Area and moments of every object of the image, keyed by object
+//			number. Objects measured while labeling with LABEL_MOMENTS are
+//			returned without scanning the image again.
+// ---------------------------------------------------------------------------
+ObjectTable LabeledImage::get_object_table( void ) const{
+
+	if( measured_objects.empty() ){
+
+		// Not converted, the grey levels are the labels
+		if( label_plane.empty() )
+			return ObjectTable( *this );
+
+		return ObjectTable( &label_plane[ 0 ], getNRows(), getNCols(), object_count + 1 );
+	}
+
+	// Every object measured, keyed by its number
+	ObjectTable objects( (int)measured_objects.size() );
+	for( int object = 1; object < (int)measured_objects.size(); object++ )
+		objects.add( object, measured_objects[ object ] );
 	return objects;
 }
 
+// ---------------------------------------------------------------------------
+// Get_Objects
+// Purpose: Gets all the unique objects from the image.
+// ---------------------------------------------------------------------------
+std::map< int, ObjectInfo > LabeledImage::get_objects( void ) const{
+
+	return get_object_table().to_map();
+}
+
 // ---------------------------------------------------------------------------
 // Process_Data
 // Purpose: Calculate the row center, column center, minimum inertia, and 
 //			orientation. Write the information to a database text 
-//			file, and creates a line from ( row center, column center )
-//			to the direction of the orientation on this image.
+//			or binary file, and creates a line from ( row center, column
+//			center ) to the direction of the orientation on this image.
 // Parameters:
 // 		1: output path
+//		2: Database format
 // ---------------------------------------------------------------------------
-void LabeledImage::process_data( const char* output_file ){
+void LabeledImage::process_data( const char* output_file, const DatabaseFormat format, const bool append ){
 
 	std::map< int, ObjectInfo > objects = get_objects();
 
 	// Create database
-	std::ofstream database ( output_file );
+	ObjectDatabase database;
 
 	// Calculate object centers, min moments, and orientation
-	// & Write them to the database
+	// & Add them to the database
 	std::map< int, ObjectInfo >::iterator it;
 	for ( it = objects.begin(); it != objects.end(); it++ ){
 		
 		const int label = it->first;
 		const double row_center = it->second.calculateRowCenter();
 		const double col_center = it->second.calculateColCenter();
-		const double min_inertia = it->second.calculateMinInertia();
 		const double orientation = it->second.calculateOrientation();
 
-		database << label << " "; // Write label
-		database << row_center << " "; // Write row center
-		database << col_center << " "; // Write column center
-		database << min_inertia << " "; // Write min inertia
-		database << orientation << " "; // Write orientation in RADIANS
-		database << it->second.area; // Write area
-		database << std::endl;
+		database.add( ObjectDatabase::make_record( label, it->second ) );
 
 		// Normalized direction vector
 		std::pair< double, double > direction_vector( cos( orientation ), sin( orientation ) );
@@ -229,7 +1008,7 @@ void LabeledImage::process_data( const char* output_file ){
 			, col_center
 			, ( row_center + ( direction_vector.first  * 60 ) )
 			, ( col_center + ( direction_vector.second * 60 ) )
-			, label + 1 );
+			, get_grey_level( label + 1 ) );
 		
 		// Finish drawing orientation line through object
 		 line( im
@@ -237,11 +1016,77 @@ void LabeledImage::process_data( const char* output_file ){
 		 	, col_center
 		 	, ( row_center - ( direction_vector.first  * 60 ) )
 		 	, ( col_center - ( direction_vector.second * 60 ) )
-		 	, label + 1 );
+		 	, get_grey_level( label + 1 ) );
 			 
 		// Mark a black dot at ( row_center, col_center )
 		setPixel( row_center, col_center, 0 );
 	}
+
+	// Write database, or add to it
+	if( ( append ? database.append( output_file, format ) : database.write( output_file, format ) ) < 0 )
+		std::cout << "Cannot write database " << output_file << std::endl;
+}
+
+// ---------------------------------------------------------------------------
+// Shape_Matches
+// Purpose: Cheap check that an object could be a database entry. Perimeter
+//			and the first Hu invariant are both unchanged by rotation (but
+//			for pixel steps on diagonals, up to a factor of sqrt( 2 ) on the
+//			perimeter), so entries off by more than that are rejected.
+//
+// Parameters:
+//		1: Object
+//		2: Perimeter of the database entry
+//		3: First Hu invariant of the database entry
+// ---------------------------------------------------------------------------
+static bool shape_matches( const ObjectInfo& object, const double perimeter, const double hu ){
+
+	const double perimeter_ratio = 1.5;
+	const double hu_tolerance = 0.25;
+
+	const double p = object.getPerimeter();
+	if( p > perimeter * perimeter_ratio || p * perimeter_ratio < perimeter )
+		return false;
+
+	const double h = object.getFeatures().hu[ 0 ];
+	return std::abs( h - hu ) <= hu_tolerance * std::max( h, hu );
+}
+
+// ---------------------------------------------------------------------------
+// Mark_Match
+// Purpose: Draws a white line through a matched object along its
+//			orientation, with a black dot at its center.
+//
+// Parameters:
+//		1: Image drawn on
+//		2: Object matched
+// ---------------------------------------------------------------------------
+static void mark_match( Image* im, const ObjectInfo& object ){
+
+	// Features are worked out once per object, whichever entries it matches
+	const ObjectFeatures& found = object.getFeatures();
+	
+	// Normalized direction vector
+	std::pair< double, double > dv( cos( found.orientation ), sin( found.orientation ) );
+	
+	// Mark the found objects
+	line( im
+		, found.row_center
+		, found.col_center
+		, ( found.row_center + ( dv.first  * 60 ) )
+		, ( found.col_center + ( dv.second * 60 ) )
+		, 255 );
+		
+	// Mark the found objects
+	line( im
+		, found.row_center
+		, found.col_center
+		, ( found.row_center - ( dv.first  * 60 ) )
+		, ( found.col_center - ( dv.second * 60 ) )
+		, 255 );
+		
+	// Mark a black dot at ( row_center, col_center )
+	im->setPixel( found.row_center, found.col_center, 0 );
 }
 
 // ---------------------------------------------------------------------------
@@ -249,90 +1094,275 @@ void LabeledImage::process_data( const char* output_file ){
 // Purpose: Compares this image to a database filled with the following values:
 //			label, center_x, center_y, minimum inertia, orientation separated
 //			by a space, in a line by line format. Each line represents a
-//			unique object.
+//			unique object. Binary databases are mapped and read in place.
 // Parameters:
 // 		1: database path
+//		2: How to pair entries with objects
 // ---------------------------------------------------------------------------
-void LabeledImage::compare_to( const char* database ){
+std::vector< Match > LabeledImage::compare_to( const char* database, const MatchMethod method ){
 
-	// Create map of label -> object info
-	std::map< int, ObjectInfo > objects = get_objects();
+	// Load database, binary ones are mapped as they are
+	const ObjectDatabase db( database );
+
+	return compare_to( db, method );
+}
+
+// ---------------------------------------------------------------------------
+// Compare_To
+// Purpose: Compares this image to a loaded database. Each entry is paired
+//			with the last object within 500 of its area (and of similar
+//			shape, given descriptors), or the index or feature store of the
+//			database is built and each object paired with its nearest entry.
+// Parameters:
+// 		1: database
+//		2: How to pair entries with objects
+// ---------------------------------------------------------------------------
+std::vector< Match > LabeledImage::compare_to( const ObjectDatabase& db, const MatchMethod method ){
 
-	// Read from database
-	std::ifstream db( database );
+	if( method == MATCH_NEAREST ){
+		const FeatureIndex index( db );
+		return compare_to( index );
+	}
 
-	std::string	file_line;
+	if( method == MATCH_SCAN || method == MATCH_ASSIGN ){
+		const FeatureStore store( db );
+		return compare_to( store, MATCH_TOLERANCE, method == MATCH_ASSIGN );
+	}
 
-	// Iterate through each object in the database
-	while( std::getline( db, file_line ) ){
+	std::vector< Match > matches;
 
-		std::istringstream ss( file_line );
-		std::vector< std::string > values;
+	// Create map of label -> object info
+	std::map< int, ObjectInfo > objects = get_objects();
 
-		// Save object values into array
-		while( ss ){
+	// Iterate through each object in the database
+	for( const ObjectRecord* entry = db.begin(); entry != db.end(); entry++ ){
 
-			std::string str;
-			ss >> str;
-			values.push_back( str );
-		}
+		const double area1 = entry->area;
 
-		// Get objects from array
-		const double rc1 = atof( values[ 1 ].c_str() );
-		const double cc1 = atof( values[ 2 ].c_str() );
-		const double inertia1 = atof( values[ 3 ].c_str() );
-		const double orientation1 = atof( values[ 4 ].c_str() );
-		const double area1 = atof( values[ 5 ].c_str());
+		// Newer databases also hold bounding box, perimeter and Hu
+		// invariants
+		const bool has_descriptors = entry->flags & RECORD_HAS_DESCRIPTORS;
+		const double perimeter1 = entry->perimeter;
+		const double hu1 = entry->hu[ 0 ];
 
 		// Placeholder for object with closest area
-		ObjectInfo* min_area_diff = 0;
+		std::map< int, ObjectInfo >::iterator min_area_diff = objects.end();
 
 		// Threshold for area matching
 		const double threshold = 500;
 
-		// Calculate object centers, min moments, and orientation
-		// & Compare them to the database
+		// Compare objects to the database entry
 		std::map< int, ObjectInfo >::iterator it;
 		for ( it = objects.begin(); it != objects.end(); it++ ){
-			
-			const double rc2 = it->second.calculateRowCenter();
-			const double cc2 = it->second.calculateColCenter();
-			const double inertia2 = it->second.calculateMinInertia();
-			const double orientation2 = it->second.calculateOrientation();
 
-			const double area2 = it->second.area;
-			const double eei_2 = it->second.eei; 
+			const double area2 = it->second.getArea();
+
+			// Reject objects whose shape can't match before comparing areas
+			if( has_descriptors && !shape_matches( it->second, perimeter1, hu1 ) )
+				continue;
 
 			// Get object with min area
-			if( std::abs( area1 - area2 ) < 500 )
-				min_area_diff = &it->second;
+			if( std::abs( area1 - area2 ) < threshold )
+				min_area_diff = it;
 		}
 		
 		// Match by area found
-		if( min_area_diff ){
-			
-			// Normalized direction vector
-			std::pair< double, double > dv( cos( min_area_diff->calculateOrientation() ), sin( min_area_diff->calculateOrientation() ) );
-			
-			// Mark the found objects
-			Image* im = this;
-			line( im
-				, min_area_diff->calculateRowCenter()
-				, min_area_diff->calculateColCenter()
-				, ( min_area_diff->calculateRowCenter() + ( dv.first  * 60 ) )
-				, ( min_area_diff->calculateColCenter() + ( dv.second * 60 ) )
-				, 255 );
-				
-			// Mark the found objects
-			line( im
-				, min_area_diff->calculateRowCenter()
-				, min_area_diff->calculateColCenter()
-				, ( min_area_diff->calculateRowCenter() - ( dv.first  * 60 ) )
-				, ( min_area_diff->calculateColCenter() - ( dv.second * 60 ) )
-				, 255 );
-				
-			// Mark a black dot at ( row_center, col_center )
-			setPixel( min_area_diff->calculateRowCenter(), min_area_diff->calculateColCenter(), 0 );
+		if( min_area_diff != objects.end() ){
+
+			Match match;
+			match.label = min_area_diff->first;
+			match.entry = (int)( entry - db.begin() );
+			match.distance = std::abs( area1 - min_area_diff->second.getArea() );
+			matches.push_back( match );
+
+			mark_match( this, min_area_diff->second );
+		}
+	}
+
+	return matches;
+}
+
+// ---------------------------------------------------------------------------
+// Compare_To
+// Purpose: Pairs each object with its nearest database entry in feature
+//			space, if within the tolerance, and marks the objects paired.
+// Parameters:
+// 		1: Index of the database
+//		2: Farthest feature distance of a match
+// ---------------------------------------------------------------------------
+std::vector< Match > LabeledImage::compare_to( const FeatureIndex& index, const double tolerance ){
+
+	std::vector< Match > matches;
+
+	// Create map of label -> object info
+	std::map< int, ObjectInfo > objects = get_objects();
+
+	// Query the index with every object, before any is drawn over
+	std::map< int, ObjectInfo >::iterator it;
+	for ( it = objects.begin(); it != objects.end(); it++ ){
+
+		const std::vector< Neighbour > nearest = index.nearest( it->second, 1, tolerance );
+		if( nearest.empty() )
+			continue;
+
+		Match match;
+		match.label = it->first;
+		match.entry = nearest[ 0 ].entry;
+		match.distance = nearest[ 0 ].distance;
+		matches.push_back( match );
+	}
+
+	for( size_t m = 0; m < matches.size(); m++ )
+		mark_match( this, objects[ matches[ m ].label ] );
+
+	return matches;
+}
+
+// ---------------------------------------------------------------------------
+// Assign_Entries
+// Purpose: Pairs objects and entries one to one. Only entries within the
+//			tolerance of an object are arcs of its row, so hopeless pairs
+//			never reach the solver, and of those only the nearest as many
+//			as there are objects: an object paired farther would have one
+//			of them free to take instead. Each row also gets a column of
+//			its own for staying unpaired, costing tolerance^2, no more than
+//			any arc.
+// Parameters:
+//		1: Features of the database
+//		2: Objects
+//		3: Farthest feature distance of a pair
+//		4: Out: Entry paired with each object, -1 if none
+// ---------------------------------------------------------------------------
+static void assign_entries( const FeatureStore& store, const std::vector< const ObjectInfo* >& objects,
+							const double tolerance, std::vector< Neighbour >& found ){
+
+	const int n = (int)objects.size();
+
+	// Entries near each object, each band of objects on its own thread
+	std::vector< std::vector< Neighbour > > near( n );
+	parallel_bands( n, [ & ]( const int first, const int last, int ){
+		for( int o = first; o < last; o++ ){
+
+			near[ o ] = store.within( *objects[ o ], tolerance );
+
+			if( near[ o ].size() > (size_t)n ){
+				std::nth_element( near[ o ].begin(), near[ o ].begin() + n, near[ o ].end(),
+					[]( const Neighbour& a, const Neighbour& b ){ return a.distance < b.distance; } );
+				near[ o ].resize( n );
+			}
+		}
+	} );
+
+	std::vector< int > rows;				// Object of each row
+	std::vector< int > entries;				// Entry of each column
+	std::vector< int > column( store.size(), -1 );
+	for( int o = 0; o < n; o++ ){
+
+		found[ o ].entry = -1;
+		found[ o ].distance = 0;
+		if( near[ o ].empty() )
+			continue;
+
+		rows.push_back( o );
+		for( size_t k = 0; k < near[ o ].size(); k++ ){
+			const int e = near[ o ][ k ].entry;
+			if( column[ e ] < 0 ){
+				column[ e ] = (int)entries.size();
+				entries.push_back( e );
+			}
+		}
+	}
+
+	const int n_rows = (int)rows.size();
+	const int n_entries = (int)entries.size();
+
+	std::vector< std::vector< Arc > > arcs( n_rows );
+	for( int r = 0; r < n_rows; r++ ){
+
+		const std::vector< Neighbour >& candidates = near[ rows[ r ] ];
+		arcs[ r ].resize( candidates.size() + 1 );
+
+		for( size_t k = 0; k < candidates.size(); k++ ){
+			arcs[ r ][ k ].col = column[ candidates[ k ].entry ];
+			arcs[ r ][ k ].cost = candidates[ k ].distance * candidates[ k ].distance;
 		}
+
+		arcs[ r ].back().col = n_entries + r;
+		arcs[ r ].back().cost = tolerance * tolerance;
+	}
+
+	const std::vector< int > paired = solve_assignment( arcs, n_entries + n_rows );
+
+	for( int r = 0; r < n_rows; r++ ){
+
+		const int c = paired[ r ];
+		if( c >= n_entries )
+			continue;
+
+		const std::vector< Neighbour >& candidates = near[ rows[ r ] ];
+		for( size_t k = 0; k < candidates.size(); k++ )
+			if( candidates[ k ].entry == entries[ c ] )
+				found[ rows[ r ] ] = candidates[ k ];
 	}
-}
\ No newline at end of file
+}
+
+// ---------------------------------------------------------------------------
+// Compare_To
+// Purpose: Pairs each object with its nearest entry of the store, or one
+//			to one, if within the tolerance, and marks the objects paired.
+//			Each band of objects is scored on its own thread.
+// Parameters:
+// 		1: Features of the database
+//		2: Farthest feature distance of a match
+//		3: Match one to one?
+// ---------------------------------------------------------------------------
+std::vector< Match > LabeledImage::compare_to( const FeatureStore& store, const double tolerance,
+											   const bool one_to_one ){
+
+	// Create map of label -> object info
+	std::map< int, ObjectInfo > objects = get_objects();
+
+	std::vector< std::map< int, ObjectInfo >::iterator > order;
+	for( std::map< int, ObjectInfo >::iterator it = objects.begin(); it != objects.end(); it++ )
+		order.push_back( it );
+
+	// Entry matched to each object, -1 if none
+	std::vector< Neighbour > found( order.size() );
+
+	if( one_to_one ){
+
+		std::vector< const ObjectInfo* > pointers( order.size() );
+		for( size_t o = 0; o < order.size(); o++ )
+			pointers[ o ] = &order[ o ]->second;
+
+		assign_entries( store, pointers, tolerance, found );
+	}
+	else{
+
+		parallel_bands( (int)order.size(), [ & ]( const int first, const int last, int ){
+
+			for( int o = first; o < last; o++ ){
+				const std::vector< Neighbour > nearest = store.nearest( order[ o ]->second, 1, tolerance );
+				found[ o ].entry = nearest.empty() ? -1 : nearest[ 0 ].entry;
+				found[ o ].distance = nearest.empty() ? 0 : nearest[ 0 ].distance;
+			}
+		} );
+	}
+
+	std::vector< Match > matches;
+	for( size_t o = 0; o < order.size(); o++ ){
+
+		if( found[ o ].entry < 0 )
+			continue;
+
+		Match match;
+		match.label = order[ o ]->first;
+		match.entry = found[ o ].entry;
+		match.distance = found[ o ].distance;
+		matches.push_back( match );
+
+		mark_match( this, order[ o ]->second );
+	}
+
+	return matches;
+}
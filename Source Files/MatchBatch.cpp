@@ -0,0 +1,159 @@
+// ---------------------------------------------------------------------------
+// MatchBatch.cpp
+// Matches many labeled images against one object database. The database,
+// and its index or feature store, are loaded and built once and shared by
+// a pool of worker threads, each matching a whole image at a time.
+// ---------------------------------------------------------------------------
+
+#include "MatchBatch.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Builds what the match method needs from the database.
+// ---------------------------------------------------------------------------
+MatchBatch::MatchBatch( const ObjectDatabase& db, const MatchMethod match_method )
+	: database( db ), method( match_method ), index( 0 ), store( 0 ){
+
+	if( method == MATCH_NEAREST )
+		index = new FeatureIndex( database );
+	else if( method == MATCH_SCAN || method == MATCH_ASSIGN )
+		store = new FeatureStore( database );
+}
+
+MatchBatch::~MatchBatch( void ){
+
+	delete index;
+	delete store;
+}
+
+// ---------------------------------------------------------------------------
+// Compare
+// Purpose: Matches one labeled image with the structures built up front.
+// ---------------------------------------------------------------------------
+std::vector< Match > MatchBatch::compare( LabeledImage& image ) const{
+
+	if( index )
+		return image.compare_to( *index );
+	if( store )
+		return image.compare_to( *store, MATCH_TOLERANCE, method == MATCH_ASSIGN );
+
+	return image.compare_to( database, method );
+}
+
+// ---------------------------------------------------------------------------
+// Run
+// Purpose: Reads, matches and writes every image on a pool of workers.
+// ---------------------------------------------------------------------------
+std::vector< ImageMatches > MatchBatch::run( const std::vector< std::string >& images,
+											 const std::vector< std::string >& outputs,
+											 const bool binary, const int workers ) const{
+
+	std::vector< ImageMatches > results( images.size() );
+
+	parallel_tasks( (int)images.size(), [ & ]( const int task, int ){
+
+		ImageMatches& result = results[ task ];
+		result.image = images[ task ];
+		result.ok = false;
+
+		try{
+
+			LabeledImage image( images[ task ].c_str(), binary, LABEL_MOMENTS );
+			result.matches = compare( image );
+
+			if( !outputs.empty() ){
+				if( writeImage( &image, outputs[ task ].c_str(), 1 ) < 0 )
+					return;
+				result.output = outputs[ task ];
+			}
+
+			result.ok = true;
+		}
+		catch( const std::exception& ){
+			// Unreadable image, left as failed
+		}
+	}, workers );
+
+	return results;
+}
+
+// ---------------------------------------------------------------------------
+// Write_Results
+// Purpose: Writes the matches of a batch to one text file.
+// ---------------------------------------------------------------------------
+int MatchBatch::write_results( const char* path, const std::vector< ImageMatches >& results ) const{
+
+	std::ofstream file( path );
+	if( !file )
+		return -1;
+
+	for( size_t r = 0; r < results.size(); r++ ){
+
+		if( !results[ r ].ok ){
+			file << results[ r ].image << " failed" << '\n';
+			continue;
+		}
+
+		const std::vector< Match >& matches = results[ r ].matches;
+		for( size_t m = 0; m < matches.size(); m++ ){
+			file << results[ r ].image << " ";
+			file << matches[ m ].label << " ";
+			file << matches[ m ].entry << " ";
+			file << database[ matches[ m ].entry ].label << " ";
+			file << matches[ m ].distance << '\n';
+		}
+	}
+
+	return file ? 0 : -1;
+}
+
+// ---------------------------------------------------------------------------
+// List_Images
+// Purpose: Paths of a batch, from a directory or a list file.
+// ---------------------------------------------------------------------------
+std::vector< std::string > MatchBatch::list_images( const char* path ){
+
+	std::vector< std::string > images;
+	struct stat info;
+
+	if( !path || stat( path, &info ) )
+		return images;
+
+	if( S_ISDIR( info.st_mode ) ){
+
+		DIR* dir = opendir( path );
+		if( !dir )
+			return images;
+
+		const std::string prefix = std::string( path ) + "/";
+		for( struct dirent* entry = readdir( dir ); entry; entry = readdir( dir ) ){
+			const std::string name = entry->d_name;
+			if( name.size() > 4 && name.compare( name.size() - 4, 4, ".pgm" ) == 0 )
+				images.push_back( prefix + name );
+		}
+		closedir( dir );
+
+		std::sort( images.begin(), images.end() );
+		return images;
+	}
+
+	std::ifstream list( path );
+	std::string line;
+	while( std::getline( list, line ) ){
+
+		// Trim surrounding blanks, and a \r left by DOS line ends
+		const size_t first = line.find_first_not_of( " \t\r" );
+		if( first == std::string::npos )
+			continue;
+		const size_t last = line.find_last_not_of( " \t\r" );
+		images.push_back( line.substr( first, last - first + 1 ) );
+	}
+
+	return images;
+}
@@ -0,0 +1,464 @@
+// ---------------------------------------------------------------------------
+// MatchServer.cpp
+// Long running matcher: keeps an object database and its index resident
+// and matches frames sent by local producers over a Unix domain socket,
+// reloading the database whenever its file changes. Also the client side
+// of the protocol.
+// ---------------------------------------------------------------------------
+
+#include "MatchServer.h"
+#include "Parallel.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// ---------------------------------------------------------------------------
+// Read_Fully
+// Purpose: Reads exactly length bytes, however the socket splits them.
+//
+// Returns: 0 if OK, -1 on error or if the connection closed first
+// ---------------------------------------------------------------------------
+static int read_fully( const int fd, void* buffer, size_t length ){
+
+	char* at = (char*)buffer;
+	while( length ){
+		const ssize_t n = read( fd, at, length );
+		if( n < 0 && errno == EINTR )
+			continue;
+		if( n <= 0 )
+			return -1;
+		at += n;
+		length -= n;
+	}
+	return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Write_Fully
+// Purpose: Writes exactly length bytes to a socket, without raising
+//			SIGPIPE if the peer has gone.
+//
+// Returns: 0 if OK or -1 on error
+// ---------------------------------------------------------------------------
+static int write_fully( const int fd, const void* buffer, size_t length ){
+
+	const char* at = (const char*)buffer;
+	while( length ){
+		const ssize_t n = send( fd, at, length, MSG_NOSIGNAL );
+		if( n < 0 && errno == EINTR )
+			continue;
+		if( n <= 0 )
+			return -1;
+		at += n;
+		length -= n;
+	}
+	return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Socket_Address
+// Purpose: Fills a Unix socket address.
+//
+// Returns: 0 if OK or -1 if the path doesn't fit
+// ---------------------------------------------------------------------------
+static int socket_address( const char* socket_path, struct sockaddr_un& address ){
+
+	memset( &address, 0, sizeof( address ) );
+	address.sun_family = AF_UNIX;
+
+	if( !socket_path || strlen( socket_path ) >= sizeof( address.sun_path ) )
+		return -1;
+
+	strcpy( address.sun_path, socket_path );
+	return 0;
+}
+
+bool MatchServer::Version::operator==( const Version& other ) const{
+
+	return device == other.device && inode == other.inode && size == other.size
+		&& modified == other.modified && modified_ns == other.modified_ns;
+}
+
+// ---------------------------------------------------------------------------
+// File_Version
+// Purpose: Identity of the file at a path: a rename over it changes the
+//			inode, a write in place the size or modification time. All 0
+//			if there's no file.
+// ---------------------------------------------------------------------------
+MatchServer::Version MatchServer::file_version( const char* file ){
+
+	Version v;
+	memset( &v, 0, sizeof( v ) );
+
+	struct stat info;
+	if( stat( file, &info ) )
+		return v;
+
+	v.device = info.st_dev;
+	v.inode = info.st_ino;
+	v.size = info.st_size;
+	v.modified = info.st_mtim.tv_sec;
+	v.modified_ns = info.st_mtim.tv_nsec;
+	return v;
+}
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Loads the database and builds what the match method needs. The
+//			file is looked at first, so a change while loading is picked up
+//			by the next reload.
+// ---------------------------------------------------------------------------
+MatchServer::MatchServer( const char* database, const MatchMethod match_method,
+						  const int64_t max_pixels, const int max_connections )
+	: path( database ? database : "" ), method( match_method ), frame_max_pixels( max_pixels ),
+	  connection_limit( max_connections > 0 ? max_connections : 1 ), stopping( false ){
+
+	version = file_version( path.c_str() );
+	resident = std::make_shared< const Resident >( path.c_str(), method );
+}
+
+// ---------------------------------------------------------------------------
+// Current
+// Purpose: The resident database, kept alive for the caller even if it's
+//			replaced meanwhile.
+// ---------------------------------------------------------------------------
+std::shared_ptr< const MatchServer::Resident > MatchServer::current( void ){
+
+	std::lock_guard< std::mutex > guard( lock );
+	return resident;
+}
+
+// ---------------------------------------------------------------------------
+// Reload_If_Changed
+// Purpose: Reloads the database if its file was replaced or modified. The
+//			new database is loaded and indexed before taking the lock, so
+//			frames are never held up by a reload.
+// ---------------------------------------------------------------------------
+bool MatchServer::reload_if_changed( void ){
+
+	const Version v = file_version( path.c_str() );
+
+	// A missing file keeps the database there was
+	if( v.inode == 0 )
+		return false;
+
+	{
+		std::lock_guard< std::mutex > guard( lock );
+		if( v == version )
+			return false;
+	}
+
+	std::shared_ptr< const Resident > loaded;
+	try{
+		loaded = std::make_shared< const Resident >( path.c_str(), method );
+	}
+	catch( const std::exception& e ){
+
+		// Not tried again until the file changes once more
+		std::lock_guard< std::mutex > guard( lock );
+		version = v;
+		std::cout << "Keeping the database, cannot reload " << path << ": " << e.what() << std::endl;
+		return false;
+	}
+
+	{
+		std::lock_guard< std::mutex > guard( lock );
+		resident = loaded;
+		version = v;
+	}
+
+	std::cout << "Reloaded " << path << ", " << loaded->database.size() << " entries" << std::endl;
+	return true;
+}
+
+// ---------------------------------------------------------------------------
+// Match_Frame
+// Purpose: Matches one frame against the resident database, taking over
+//			its pixels.
+// ---------------------------------------------------------------------------
+void MatchServer::match_frame( Image&& frame, const bool binary, std::vector< ReplyMatch >& replies ){
+
+	const std::shared_ptr< const Resident > r = current();
+
+	LabeledImage image( std::move( frame ), binary, LABEL_MOMENTS );
+	const std::vector< Match > matches = r->batch.compare( image );
+
+	replies.resize( matches.size() );
+	for( size_t m = 0; m < matches.size(); m++ ){
+		replies[ m ].label = matches[ m ].label;
+		replies[ m ].entry = matches[ m ].entry;
+		replies[ m ].db_label = r->database[ matches[ m ].entry ].label;
+		replies[ m ].reserved = 0;
+		replies[ m ].distance = matches[ m ].distance;
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Handle
+// Purpose: Serves the frames of one connection until it closes. A frame
+//			that can't be taken gets a rejection and ends the connection,
+//			the stream being out of step after it. Pixels are read straight
+//			into the frame, which is only held while it's served.
+//			Connections already run side by side, so each frame is labeled
+//			and measured in one band on this thread instead of starting
+//			threads on every core.
+// ---------------------------------------------------------------------------
+void MatchServer::handle( Connection* connection ){
+
+	SerialBands serial;
+
+	const int fd = connection->socket;
+	std::vector< ReplyMatch > replies;
+	std::vector< char > reply;
+
+	FrameHeader header;
+	while( read_fully( fd, &header, sizeof( header ) ) == 0 ){
+
+		ReplyHeader out;
+		memcpy( out.magic, REPLY_MAGIC, sizeof( out.magic ) );
+		out.status = -1;
+		out.count = 0;
+		out.reserved = 0;
+
+		const bool valid = memcmp( header.magic, FRAME_MAGIC, sizeof( header.magic ) ) == 0
+						&& header.rows > 0 && header.cols > 0
+						&& (int64_t)header.rows * header.cols <= frame_max_pixels;
+
+		Image frame;
+		if( !valid || frame.setSize( header.rows, header.cols ) < 0 ){
+			write_fully( fd, &out, sizeof( out ) );
+			break;
+		}
+
+		// Rows back to back in one read if the frame has no padding
+		bool received = true;
+		if( frame.getStride() == header.cols )
+			received = read_fully( fd, frame.getData(), (size_t)header.rows * header.cols ) == 0;
+		else
+			for( int i = 0; i < header.rows && received; i++ )
+				received = read_fully( fd, frame.getRow( i ), header.cols ) == 0;
+		if( !received )
+			break;
+
+		try{
+			match_frame( std::move( frame ), ( header.flags & FRAME_BINARY ) != 0, replies );
+		}
+		catch( const std::exception& ){
+			write_fully( fd, &out, sizeof( out ) );
+			break;
+		}
+
+		// Header and matches in one write
+		out.status = 0;
+		out.count = (int32_t)replies.size();
+		reply.resize( sizeof( out ) + replies.size() * sizeof( ReplyMatch ) );
+		memcpy( &reply[ 0 ], &out, sizeof( out ) );
+		if( !replies.empty() )
+			memcpy( &reply[ sizeof( out ) ], &replies[ 0 ], replies.size() * sizeof( ReplyMatch ) );
+
+		if( write_fully( fd, &reply[ 0 ], reply.size() ) < 0 )
+			break;
+	}
+
+	// The accepting thread joins this thread and closes the socket
+	std::lock_guard< std::mutex > guard( connections_lock );
+	connection->done = true;
+	connection_done.notify_all();
+}
+
+// ---------------------------------------------------------------------------
+// Reap_Connections
+// Purpose: Joins the threads of connections that are done and closes their
+//			sockets, first waiting for one to finish if as many connections
+//			as allowed are open.
+//
+// Parameters:
+//		1: Lock held on connections_lock
+// ---------------------------------------------------------------------------
+void MatchServer::reap_connections( std::unique_lock< std::mutex >& guard ){
+
+	for( ;; ){
+
+		for( std::list< Connection >::iterator c = connections.begin(); c != connections.end(); ){
+			if( !c->done ){
+				c++;
+				continue;
+			}
+			c->thread.join();
+			close( c->socket );
+			c = connections.erase( c );
+		}
+
+		if( (int)connections.size() < connection_limit )
+			return;
+
+		connection_done.wait( guard );
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Watch
+// Purpose: Checks the database file for changes every second, until told
+//			to stop.
+// ---------------------------------------------------------------------------
+void MatchServer::watch( void ){
+
+	std::unique_lock< std::mutex > guard( connections_lock );
+	while( !stop_requested.wait_for( guard, std::chrono::seconds( 1 ), [ this ](){ return stopping; } ) ){
+		guard.unlock();
+		reload_if_changed();
+		guard.lock();
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Stop_Serving
+// Purpose: Ends every thread serve() started: the watcher is woken, and
+//			open connections are shut down so their reads fail, then all of
+//			them are joined. Nothing refers to the server afterwards.
+//
+// Parameters:
+//		1: Watcher thread
+// ---------------------------------------------------------------------------
+void MatchServer::stop_serving( std::thread& watcher ){
+
+	{
+		std::lock_guard< std::mutex > guard( connections_lock );
+		stopping = true;
+		for( std::list< Connection >::iterator c = connections.begin(); c != connections.end(); c++ )
+			shutdown( c->socket, SHUT_RDWR );
+	}
+	stop_requested.notify_all();
+	watcher.join();
+
+	// Handlers take the lock to say they're done, so join them without it;
+	// only this thread changes the list
+	for( std::list< Connection >::iterator c = connections.begin(); c != connections.end(); c++ ){
+		c->thread.join();
+		close( c->socket );
+	}
+	connections.clear();
+}
+
+// ---------------------------------------------------------------------------
+// Serve
+// Purpose: Listens on a Unix domain socket and serves each connection on
+//			its own thread, while another thread watches the database file.
+// ---------------------------------------------------------------------------
+int MatchServer::serve( const char* socket_path ){
+
+	struct sockaddr_un address;
+	if( socket_address( socket_path, address ) < 0 ){
+		std::cout << "Socket path too long" << std::endl;
+		return -1;
+	}
+
+	const int listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if( listener < 0 )
+		return -1;
+
+	// A socket file left by an earlier server would fail the bind
+	unlink( socket_path );
+
+	if( bind( listener, (struct sockaddr*)&address, sizeof( address ) ) || listen( listener, SOMAXCONN ) ){
+		std::cout << "Cannot listen on " << socket_path << ": " << strerror( errno ) << std::endl;
+		close( listener );
+		return -1;
+	}
+
+	{
+		std::lock_guard< std::mutex > guard( connections_lock );
+		stopping = false;
+	}
+	std::thread watcher( &MatchServer::watch, this );
+
+	for( ;; ){
+
+		// Wait for a free slot before taking another connection
+		{
+			std::unique_lock< std::mutex > guard( connections_lock );
+			reap_connections( guard );
+		}
+
+		const int fd = accept( listener, 0, 0 );
+		if( fd < 0 ){
+			if( errno == EINTR || errno == ECONNABORTED )
+				continue;
+			std::cout << "Cannot accept connections: " << strerror( errno ) << std::endl;
+			stop_serving( watcher );
+			close( listener );
+			return -1;
+		}
+
+		std::lock_guard< std::mutex > guard( connections_lock );
+		connections.push_back( Connection() );
+		Connection& connection = connections.back();
+		connection.socket = fd;
+		connection.done = false;
+		connection.thread = std::thread( &MatchServer::handle, this, &connection );
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Connect_Matcher
+// Purpose: Connects to a match server.
+// ---------------------------------------------------------------------------
+int connect_matcher( const char* socket_path ){
+
+	struct sockaddr_un address;
+	if( socket_address( socket_path, address ) < 0 )
+		return -1;
+
+	const int connection = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if( connection < 0 )
+		return -1;
+
+	if( connect( connection, (struct sockaddr*)&address, sizeof( address ) ) ){
+		close( connection );
+		return -1;
+	}
+
+	return connection;
+}
+
+// ---------------------------------------------------------------------------
+// Send_Frame
+// Purpose: Sends a frame on a connection and waits for its matches.
+// ---------------------------------------------------------------------------
+int send_frame( const int connection, const Image& frame, const bool binary, std::vector< ReplyMatch >& matches ){
+
+	FrameHeader header;
+	memcpy( header.magic, FRAME_MAGIC, sizeof( header.magic ) );
+	header.rows = frame.getNRows();
+	header.cols = frame.getNCols();
+	header.flags = binary ? FRAME_BINARY : 0;
+
+	// Header and rows back to back, in one write
+	std::vector< unsigned char > request( sizeof( header ) + (size_t)header.rows * header.cols );
+	memcpy( &request[ 0 ], &header, sizeof( header ) );
+	for( int i = 0; i < header.rows; i++ )
+		memcpy( &request[ sizeof( header ) + (size_t)i * header.cols ], frame.getRow( i ), header.cols );
+
+	if( write_fully( connection, &request[ 0 ], request.size() ) < 0 )
+		return -1;
+
+	ReplyHeader reply;
+	if( read_fully( connection, &reply, sizeof( reply ) ) < 0
+		|| memcmp( reply.magic, REPLY_MAGIC, sizeof( reply.magic ) ) != 0
+		|| reply.status != 0 || reply.count < 0 )
+		return -1;
+
+	matches.resize( reply.count );
+	if( reply.count && read_fully( connection, &matches[ 0 ], matches.size() * sizeof( ReplyMatch ) ) < 0 )
+		return -1;
+
+	return 0;
+}
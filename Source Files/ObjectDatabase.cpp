@@ -0,0 +1,594 @@
+// ---------------------------------------------------------------------------
+// ObjectDatabase.cpp
+// Database of objects to match labeled images against, one record per
+// object. Stored either as text, one line per object, or as a binary file
+// of fixed size records that is mapped into memory as is.
+// ---------------------------------------------------------------------------
+
+#include "ObjectDatabase.h"
+#include "FeatureIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static_assert( sizeof( ObjectRecord ) == 128, "ObjectRecord must stay 128 bytes" );
+static_assert( sizeof( DatabaseHeader ) == 64, "DatabaseHeader must stay 64 bytes" );
+
+// Columns of a text line
+enum{
+	TEXT_COLUMNS = 6,				// label, centers, inertia, orientation, area
+	TEXT_DESCRIPTOR_COLUMNS = 18	// + bounding box, perimeter, 7 Hu invariants
+};
+
+// ---------------------------------------------------------------------------
+// Write_Text
+// Purpose: Writes records as text database lines.
+// ---------------------------------------------------------------------------
+static void write_text( std::ostream& database, const ObjectRecord* records, const size_t count ){
+
+	for( size_t i = 0; i < count; i++ ){
+
+		const ObjectRecord& r = records[ i ];
+		database << r.label << " "; // Write label
+		database << r.row_center << " "; // Write row center
+		database << r.col_center << " "; // Write column center
+		database << r.min_inertia << " "; // Write min inertia
+		database << r.orientation << " "; // Write orientation in RADIANS
+		database << r.area; // Write area
+
+		// Write bounding box, perimeter and Hu invariants
+		if( r.flags & RECORD_HAS_DESCRIPTORS ){
+			database << " " << r.min_row << " " << r.min_col;
+			database << " " << r.max_row << " " << r.max_col;
+			database << " " << r.perimeter;
+			for( int h = 0; h < 7; h++ )
+				database << " " << r.hu[ h ];
+		}
+		database << '\n';
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Write_At
+// Purpose: Writes exactly length bytes at an offset of a file.
+//
+// Returns: 0 if OK or -1 on error
+// ---------------------------------------------------------------------------
+static int write_at( const int fd, const void* buffer, size_t length, off_t offset ){
+
+	const char* at = (const char*)buffer;
+	while( length ){
+		const ssize_t n = pwrite( fd, at, length, offset );
+		if( n < 0 && errno == EINTR )
+			continue;
+		if( n <= 0 )
+			return -1;
+		at += n;
+		length -= n;
+		offset += n;
+	}
+	return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Lock_Database
+// Purpose: Takes the exclusive lock writers of a database take turns with,
+//			held on a "<path>.lock" file beside it. The database file itself
+//			can't carry the lock, as write() replaces it with a new one.
+//
+// Returns: Descriptor holding the lock, closed to release it, or -1 on error
+// ---------------------------------------------------------------------------
+static int lock_database( const char* path ){
+
+	const std::string lock_path = std::string( path ) + ".lock";
+	const int fd = open( lock_path.c_str(), O_RDWR | O_CREAT, 0644 );
+	if( fd < 0 )
+		return -1;
+
+	int locked;
+	while( ( locked = flock( fd, LOCK_EX ) ) && errno == EINTR )
+		;
+	if( locked ){
+		close( fd );
+		return -1;
+	}
+	return fd;
+}
+
+// ---------------------------------------------------------------------------
+// DuplicateFinder
+// Purpose: Feature vectors of records, hashed by the cell of a grid
+//			tolerance wide they fall in, so a record's near duplicates are
+//			only looked for in its cell and the cells around it.
+// ---------------------------------------------------------------------------
+class DuplicateFinder{
+
+public:
+
+	explicit DuplicateFinder( const double distance ) : tolerance( distance ){ }
+
+	// Is there a record within the tolerance of this one?
+	bool contains( const ObjectRecord& record ) const{
+
+		Point point;
+		int cell[ FeatureIndex::MAX_FEATURES ];
+		if( !locate( record, point, cell ) )
+			return false;
+
+		// Every cell within one of this one along each feature
+		int offset[ FeatureIndex::MAX_FEATURES ] = { -1, -1, -1, -1 };
+		for( ;; ){
+
+			int neighbour[ FeatureIndex::MAX_FEATURES ];
+			for( int d = 0; d < FeatureIndex::MAX_FEATURES; d++ )
+				neighbour[ d ] = cell[ d ] + offset[ d ];
+
+			const std::unordered_map< uint64_t, std::vector< Point > >::const_iterator found = cells.find( key( neighbour ) );
+			if( found != cells.end() )
+				for( size_t p = 0; p < found->second.size(); p++ )
+					if( distance2( point, found->second[ p ] ) <= tolerance * tolerance )
+						return true;
+
+			int d = 0;
+			while( d < FeatureIndex::MAX_FEATURES && offset[ d ] == 1 )
+				offset[ d++ ] = -1;
+			if( d == FeatureIndex::MAX_FEATURES )
+				return false;
+			offset[ d ]++;
+		}
+	}
+
+	void insert( const ObjectRecord& record ){
+
+		Point point;
+		int cell[ FeatureIndex::MAX_FEATURES ];
+		if( locate( record, point, cell ) )
+			cells[ key( cell ) ].push_back( point );
+	}
+
+private:
+
+	struct Point{
+		double feature[ FeatureIndex::MAX_FEATURES ];
+	};
+
+	const double tolerance;
+	std::unordered_map< uint64_t, std::vector< Point > > cells;
+
+	// Features and cell of a record. False if it can't have duplicates:
+	// without descriptors, areas alone can't tell shapes apart
+	bool locate( const ObjectRecord& r, Point& point, int* cell ) const{
+
+		if( tolerance <= 0 || !( r.flags & RECORD_HAS_DESCRIPTORS ) )
+			return false;
+
+		FeatureIndex::features( (double)r.area, (double)r.perimeter, r.hu[ 0 ], r.hu[ 1 ],
+								FeatureIndex::MAX_FEATURES, point.feature );
+		for( int d = 0; d < FeatureIndex::MAX_FEATURES; d++ ){
+			const double c = floor( point.feature[ d ] / tolerance );
+			cell[ d ] = (int)std::max( -32000.0, std::min( c, 32000.0 ) );
+		}
+		return true;
+	}
+
+	// 16 bits of each cell coordinate
+	static uint64_t key( const int* cell ){
+
+		uint64_t k = 0;
+		for( int d = 0; d < FeatureIndex::MAX_FEATURES; d++ )
+			k = ( k << 16 ) | (uint16_t)cell[ d ];
+		return k;
+	}
+
+	static double distance2( const Point& a, const Point& b ){
+
+		double sum = 0;
+		for( int d = 0; d < FeatureIndex::MAX_FEATURES; d++ ){
+			const double difference = a.feature[ d ] - b.feature[ d ];
+			sum += difference * difference;
+		}
+		return sum;
+	}
+};
+
+ObjectDatabase::ObjectDatabase( void ) : records( 0 ), count( 0 ), mapping( 0 ), mapping_length( 0 ),
+										 format( DB_TEXT ){ }
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Loads a database. Binary databases, told apart by their magic
+//			number, are mapped read only and used in place; text ones are
+//			read whole and parsed.
+// ---------------------------------------------------------------------------
+ObjectDatabase::ObjectDatabase( const char* path ) : records( 0 ), count( 0 ), mapping( 0 ),
+													 mapping_length( 0 ), format( DB_TEXT ){
+
+	int fd;
+	struct stat info;
+
+	if( !path || ( fd = open( path, O_RDONLY ) ) < 0 )
+		return;
+
+	if( fstat( fd, &info ) ){
+		close( fd );
+		return;
+	}
+
+	char magic[ sizeof( DATABASE_MAGIC ) ];
+	const bool binary = pread( fd, magic, sizeof( magic ), 0 ) == (ssize_t)sizeof( magic )
+					 && memcmp( magic, DATABASE_MAGIC, sizeof( magic ) ) == 0;
+
+	if( !binary ){
+
+		// Read the text whole, terminated so numbers can be parsed in place
+		std::vector< char > text;
+		char buffer[ 1 << 16 ];
+		ssize_t n;
+		while( ( n = read( fd, buffer, sizeof( buffer ) ) ) > 0 )
+			text.insert( text.end(), buffer, buffer + n );
+		close( fd );
+
+		const size_t length = text.size();
+		text.push_back( '\0' );
+		parse_text( &text[ 0 ], length );
+		return;
+	}
+
+	format = DB_BINARY;
+
+	void* base = MAP_FAILED;
+	if( S_ISREG( info.st_mode ) && (size_t)info.st_size >= sizeof( DatabaseHeader ) )
+		base = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+
+	if( base == MAP_FAILED )
+		throw std::runtime_error( "Cannot map object database" );
+
+	mapping = base;
+	mapping_length = info.st_size;
+
+	// Check the header before trusting the records
+	const DatabaseHeader* header = (const DatabaseHeader*)base;
+	if( header->version != DATABASE_VERSION || header->record_size != sizeof( ObjectRecord )
+		|| header->count > ( mapping_length - sizeof( DatabaseHeader ) ) / sizeof( ObjectRecord ) ){
+		unmap();
+		throw std::runtime_error( "Damaged or unsupported object database" );
+	}
+
+	madvise( base, mapping_length, MADV_WILLNEED );
+
+	records = (const ObjectRecord*)( (const char*)base + sizeof( DatabaseHeader ) );
+	count = header->count;
+}
+
+ObjectDatabase::~ObjectDatabase( void ){ unmap(); }
+
+// ---------------------------------------------------------------------------
+// Unmap
+// Purpose: Releases the mapped file, if any.
+// ---------------------------------------------------------------------------
+void ObjectDatabase::unmap( void ){
+
+	if( mapping )
+		munmap( mapping, mapping_length );
+	mapping = 0;
+	mapping_length = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Parse_Text
+// Purpose: Parses text database lines into records. Lines with fewer than
+//			the 6 basic columns are skipped.
+//
+// Parameters:
+//		1: Text, followed by a terminating 0
+//		2: Length of the text
+// ---------------------------------------------------------------------------
+void ObjectDatabase::parse_text( const char* text, const size_t length ){
+
+	const char* p = text;
+	const char* const text_end = text + length;
+
+	while( p < text_end ){
+
+		double values[ TEXT_DESCRIPTOR_COLUMNS ];
+		int n = 0;
+
+		// Numbers up to the end of the line
+		for( ;; ){
+
+			while( *p == ' ' || *p == '\t' || *p == '\r' )
+				p++;
+			if( p >= text_end || *p == '\n' )
+				break;
+
+			char* number_end;
+			const double value = strtod( p, &number_end );
+
+			// Like atof, anything that isn't a number reads as 0
+			if( number_end == p )
+				while( p < text_end && !isspace( (unsigned char)*p ) )
+					p++;
+			else
+				p = number_end;
+
+			if( n < TEXT_DESCRIPTOR_COLUMNS )
+				values[ n++ ] = value;
+		}
+		p++; // Past the newline
+
+		if( n < TEXT_COLUMNS )
+			continue;
+
+		ObjectRecord record;
+		memset( &record, 0, sizeof( record ) );
+		record.label = (int32_t)values[ 0 ];
+		record.row_center = values[ 1 ];
+		record.col_center = values[ 2 ];
+		record.min_inertia = values[ 3 ];
+		record.orientation = values[ 4 ];
+		record.area = (int64_t)values[ 5 ];
+
+		if( n >= TEXT_DESCRIPTOR_COLUMNS ){
+			record.flags |= RECORD_HAS_DESCRIPTORS;
+			record.min_row = (int32_t)values[ 6 ];
+			record.min_col = (int32_t)values[ 7 ];
+			record.max_row = (int32_t)values[ 8 ];
+			record.max_col = (int32_t)values[ 9 ];
+			record.perimeter = (int64_t)values[ 10 ];
+			for( int h = 0; h < 7; h++ )
+				record.hu[ h ] = values[ 11 + h ];
+		}
+
+		owned.push_back( record );
+	}
+
+	records = owned.empty() ? 0 : &owned[ 0 ];
+	count = owned.size();
+}
+
+// ---------------------------------------------------------------------------
+// Make_Record
+// Purpose: Record of an object, with every descriptor set.
+// ---------------------------------------------------------------------------
+ObjectRecord ObjectDatabase::make_record( const int label, const ObjectInfo& object ){
+
+	const ObjectFeatures& features = object.getFeatures();
+
+	ObjectRecord record;
+	memset( &record, 0, sizeof( record ) );
+	record.label = label;
+	record.flags = RECORD_HAS_DESCRIPTORS;
+	record.min_row = object.getMinRow();
+	record.min_col = object.getMinCol();
+	record.max_row = object.getMaxRow();
+	record.max_col = object.getMaxCol();
+	record.area = object.getArea();
+	record.perimeter = object.getPerimeter();
+	record.row_center = features.row_center;
+	record.col_center = features.col_center;
+	record.min_inertia = features.min_inertia;
+	record.orientation = features.orientation;
+	for( int h = 0; h < 7; h++ )
+		record.hu[ h ] = features.hu[ h ];
+	return record;
+}
+
+// ---------------------------------------------------------------------------
+// Add
+// Purpose: Appends a record. A mapped database is copied into memory first.
+// ---------------------------------------------------------------------------
+void ObjectDatabase::add( const ObjectRecord& record ){
+
+	if( mapping ){
+		owned.assign( records, records + count );
+		unmap();
+	}
+
+	owned.push_back( record );
+	records = &owned[ 0 ];
+	count = owned.size();
+}
+
+// ---------------------------------------------------------------------------
+// Write
+// Purpose: Writes the database to a temporary file of its own beside the
+//			path, flushed to disk, then renames it over the path. Readers
+//			never see a half written file, whoever else writes the path
+//			meanwhile, and a database still mapped from the old file stays
+//			intact. The rename waits for an append in progress, both
+//			holding the database's lock.
+// ---------------------------------------------------------------------------
+int ObjectDatabase::write( const char* path, const DatabaseFormat output_format ) const{
+
+	if( !path )
+		return -1;
+
+	std::string temporary = std::string( path ) + ".XXXXXX";
+	const int fd = mkstemp( &temporary[ 0 ] );
+	if( fd < 0 )
+		return -1;
+
+	// mkstemp makes files only the owner can read: keep the mode of the
+	// file replaced, if any
+	struct stat info;
+	const mode_t mode = stat( path, &info ) == 0 ? ( info.st_mode & 07777 ) : 0644;
+
+	const bool ok = fchmod( fd, mode ) == 0 && write_file( fd, output_format ) == 0 && fsync( fd ) == 0;
+	if( close( fd ) || !ok ){
+		unlink( temporary.c_str() );
+		return -1;
+	}
+
+	const int lock = lock_database( path );
+	if( lock < 0 ){
+		unlink( temporary.c_str() );
+		return -1;
+	}
+
+	const bool renamed = rename( temporary.c_str(), path ) == 0;
+	close( lock );
+	if( !renamed ){
+		unlink( temporary.c_str() );
+		return -1;
+	}
+
+	return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Write_File
+// Purpose: Writes the database to an empty file.
+// ---------------------------------------------------------------------------
+int ObjectDatabase::write_file( const int fd, const DatabaseFormat output_format ) const{
+
+	if( output_format == DB_TEXT ){
+
+		std::ostringstream database;
+		write_text( database, records, count );
+
+		const std::string text = database.str();
+		return write_at( fd, text.data(), text.size(), 0 );
+	}
+
+	DatabaseHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, DATABASE_MAGIC, sizeof( header.magic ) );
+	header.version = DATABASE_VERSION;
+	header.record_size = sizeof( ObjectRecord );
+	header.count = count;
+
+	if( write_at( fd, &header, sizeof( header ), 0 ) < 0 )
+		return -1;
+
+	return count ? write_at( fd, records, count * sizeof( ObjectRecord ), sizeof( header ) ) : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Append
+// Purpose: Adds the records of this database to the end of a database file,
+//			holding the database's lock meanwhile, so other appends and
+//			write() wait until it's done.
+// ---------------------------------------------------------------------------
+int ObjectDatabase::append( const char* path, const DatabaseFormat new_format, const double tolerance ) const{
+
+	if( !path )
+		return -1;
+
+	const int lock = lock_database( path );
+	if( lock < 0 )
+		return -1;
+
+	// Opened under the lock, so no write() can replace it meanwhile
+	const int fd = open( path, O_RDWR | O_CREAT, 0644 );
+	if( fd < 0 ){
+		close( lock );
+		return -1;
+	}
+
+	int added;
+	try{
+		added = append_locked( fd, path, new_format, tolerance );
+	}
+	catch( ... ){
+		close( fd );
+		close( lock );
+		throw;
+	}
+
+	close( fd );
+	close( lock );
+	return added;
+}
+
+// ---------------------------------------------------------------------------
+// Append_Locked
+// Purpose: Adds the records not already in a locked database file. Binary
+//			records go after the last record, and only then does the count
+//			in the header grow to cover them, so a reader never sees a
+//			record half written.
+// ---------------------------------------------------------------------------
+int ObjectDatabase::append_locked( const int fd, const char* path, const DatabaseFormat new_format,
+								   const double tolerance ) const{
+
+	struct stat info;
+	if( fstat( fd, &info ) )
+		return -1;
+
+	// What's in the file, read after taking the lock
+	const ObjectDatabase existing( path );
+	const size_t existing_count = existing.size();
+	const DatabaseFormat file_format = info.st_size ? existing.getFormat() : new_format;
+
+	DuplicateFinder seen( tolerance );
+	for( size_t i = 0; i < existing_count; i++ )
+		seen.insert( existing[ i ] );
+
+	std::vector< ObjectRecord > added;
+	for( size_t i = 0; i < count; i++ ){
+		if( seen.contains( records[ i ] ) )
+			continue;
+		seen.insert( records[ i ] );
+		added.push_back( records[ i ] );
+	}
+
+	if( file_format == DB_TEXT ){
+
+		std::ostringstream lines;
+
+		// Finish a last line left without its newline
+		char last = '\n';
+		if( info.st_size && pread( fd, &last, 1, info.st_size - 1 ) == 1 && last != '\n' )
+			lines << '\n';
+
+		write_text( lines, added.empty() ? 0 : &added[ 0 ], added.size() );
+
+		const std::string text = lines.str();
+		if( !text.empty() && write_at( fd, text.data(), text.size(), info.st_size ) < 0 )
+			return -1;
+
+		return (int)added.size();
+	}
+
+	if( added.empty() && info.st_size )
+		return 0;
+
+	DatabaseHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, DATABASE_MAGIC, sizeof( header.magic ) );
+	header.version = DATABASE_VERSION;
+	header.record_size = sizeof( ObjectRecord );
+	header.count = existing_count;
+
+	// A new file starts with an empty database
+	if( !info.st_size && write_at( fd, &header, sizeof( header ), 0 ) < 0 )
+		return -1;
+
+	// Records, past anything a failed append left after the last one
+	const off_t end = sizeof( DatabaseHeader ) + existing_count * sizeof( ObjectRecord );
+	if( !added.empty() && write_at( fd, &added[ 0 ], added.size() * sizeof( ObjectRecord ), end ) < 0 )
+		return -1;
+
+	// Records reach the disk before the count covering them
+	if( fdatasync( fd ) )
+		return -1;
+
+	header.count = existing_count + added.size();
+	if( write_at( fd, &header, sizeof( header ), 0 ) < 0 )
+		return -1;
+
+	return (int)added.size();
+}
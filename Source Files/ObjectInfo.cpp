@@ -11,6 +11,13 @@
 #include <cmath>
 #include <iostream>
 #include <stdexcept>
+#include <limits>
+#include <climits>
+
+ObjectInfo::ObjectInfo( void ) : area( 0 ), eei( 0 ), eej( 0 ), eei2( 0 ), eej2( 0 ), eeij( 0 ),
+								 eei3( 0 ), eej3( 0 ), eei2j( 0 ), eeij2( 0 ), perimeter( 0 ),
+								 min_row( INT_MAX ), min_col( INT_MAX ), max_row( -1 ), max_col( -1 ),
+								 features_valid( false ){ }
 
 // ---------------------------------------------------------------------------
 // CalculateRowCenter
@@ -18,7 +25,7 @@
 //
 // Returns: Value of EEi/area, or -1 if invalid values
 // ---------------------------------------------------------------------------
-double ObjectInfo::calculateRowCenter( void ){ return ( eei / area ); }
+double ObjectInfo::calculateRowCenter( void ) const{ return getFeatures().row_center; }
 
 // ---------------------------------------------------------------------------
 // CalculateColCenter
@@ -26,7 +33,7 @@ double ObjectInfo::calculateRowCenter( void ){ return ( eei / area ); }
 //
 // Returns: Value of EEj/area, or -1 if invalid values
 // ---------------------------------------------------------------------------
-double ObjectInfo::calculateColCenter( void ){ return ( eej / area ); }
+double ObjectInfo::calculateColCenter( void ) const{ return getFeatures().col_center; }
 
 // ---------------------------------------------------------------------------
 // CalculateMinInertia
@@ -34,28 +41,7 @@ double ObjectInfo::calculateColCenter( void ){ return ( eej / area ); }
 // 			center, EEi2, and EEj2.
 // Returns: Value from minimum interia calculation
 // ---------------------------------------------------------------------------
-double ObjectInfo::calculateMinInertia( void ){ 
-
-	// Get midpoint
-	const double row_center = calculateRowCenter();
-	const double col_center = calculateColCenter();
-
-	const double a = eei2 - row_center * row_center * area;
-	const double b = 2 * eeij  - 2 * row_center * col_center * area; 
-	const double c = eej2 - col_center * col_center * area;
-
-	const double angle = atan2( b, a - c );
-	
-	const double PI = 3.141592653589793;
-	
-	const double degrees = calculateOrientation() * 180 / PI; // Convert from radians to degrees
-	
-	const double theta_min = degrees / 2;
-	
-	const double e_min = E( theta_min, a, b, c );
-
-	return e_min;
-}
+double ObjectInfo::calculateMinInertia( void ) const{ return getFeatures().min_inertia; }
 
 // ---------------------------------------------------------------------------
 // CalculateOrientation
@@ -63,17 +49,79 @@ double ObjectInfo::calculateMinInertia( void ){
 // 			and an angle.
 // Returns: Value from orientation calculation
 // ---------------------------------------------------------------------------
-double ObjectInfo::calculateOrientation( void ){ 
-	
+double ObjectInfo::calculateOrientation( void ) const{ return getFeatures().orientation; }
+
+// ---------------------------------------------------------------------------
+// CalculateFeatures
+// Purpose: Works out the feature record from the area and moments, once for
+//			every query until they change.
+// ---------------------------------------------------------------------------
+void ObjectInfo::calculateFeatures( void ) const{
+
+	ObjectFeatures& f = features;
+
 	// Get midpoint
-	const double row_center = calculateRowCenter();
-	const double col_center = calculateColCenter();
+	f.row_center = ( eei / area );
+	f.col_center = ( eej / area );
+
+	// Second moments about the whole midpoint, as databases were built
+	const double a = eei2 - f.row_center * f.row_center * area;
+	const double b = 2 * eeij  - 2 * f.row_center * f.col_center * area; 
+	const double c = eej2 - f.col_center * f.col_center * area;
+
+	f.orientation = atan2( b, a - c );
+
+	// The minimum inertia stored in databases has always halved the
+	// orientation in degrees and fed it to E() as radians. Databases hold
+	// that value, so it stays
+	const double PI = 3.141592653589793;
+	const double degrees = f.orientation * 180 / PI; // Convert from radians to degrees
+	const double theta_min = degrees / 2;
+	f.min_inertia = E( theta_min, a, b, c );
+
+	// Second moments about the exact centroid
+	const double row_centroid = (double)eei / area;
+	const double col_centroid = (double)eej / area;
+	f.a = eei2 - row_centroid * eei;
+	f.b = 2 * ( eeij - row_centroid * eej );
+	f.c = eej2 - col_centroid * eej;
+
+	// Inertia about the principal axes, in closed form
+	const double spread = sqrt( f.b * f.b + ( f.a - f.c ) * ( f.a - f.c ) );
+	f.principal_min_inertia = ( f.a + f.c - spread ) / 2;
+	f.principal_max_inertia = ( f.a + f.c + spread ) / 2;
+
+	f.elongation = ( f.principal_min_inertia > 0 )
+				 ? f.principal_max_inertia / f.principal_min_inertia
+				 : std::numeric_limits< double >::infinity();
 
-	const double a = eei2 - row_center * row_center * area;
-	const double b = 2 * eeij  - 2 * row_center * col_center * area; 
-	const double c = eej2 - col_center * col_center * area;
-	
-	return atan2( b, a - c );
+	// Third order moments about the exact centroid, x along columns and
+	// y along rows
+	const double x = col_centroid, y = row_centroid;
+	const double mu30 = eej3 - 3 * x * eej2 + 2 * x * x * eej;
+	const double mu03 = eei3 - 3 * y * eei2 + 2 * y * y * eei;
+	const double mu21 = eeij2 - 2 * x * eeij - y * eej2 + 2 * x * x * eei;
+	const double mu12 = eei2j - 2 * y * eeij - x * eei2 + 2 * y * y * eej;
+
+	// Normalized for scale
+	const double m00 = area;
+	const double n2 = m00 * m00;			// m00 ^ ( 1 + 2 / 2 )
+	const double n3 = n2 * sqrt( m00 );	// m00 ^ ( 1 + 3 / 2 )
+	const double n20 = f.c / n2, n02 = f.a / n2, n11 = f.b / 2 / n2;
+	const double n30 = mu30 / n3, n03 = mu03 / n3, n21 = mu21 / n3, n12 = mu12 / n3;
+
+	const double s1 = n30 + n12, s2 = n21 + n03;
+	const double d1 = n30 - 3 * n12, d2 = 3 * n21 - n03;
+
+	f.hu[ 0 ] = n20 + n02;
+	f.hu[ 1 ] = ( n20 - n02 ) * ( n20 - n02 ) + 4 * n11 * n11;
+	f.hu[ 2 ] = d1 * d1 + d2 * d2;
+	f.hu[ 3 ] = s1 * s1 + s2 * s2;
+	f.hu[ 4 ] = d1 * s1 * ( s1 * s1 - 3 * s2 * s2 ) + d2 * s2 * ( 3 * s1 * s1 - s2 * s2 );
+	f.hu[ 5 ] = ( n20 - n02 ) * ( s1 * s1 - s2 * s2 ) + 4 * n11 * s1 * s2;
+	f.hu[ 6 ] = d2 * s1 * ( s1 * s1 - 3 * s2 * s2 ) - d1 * s2 * ( 3 * s1 * s1 - s2 * s2 );
+
+	features_valid = true;
 }
 
 // ---------------------------------------------------------------------------
@@ -89,68 +137,120 @@ double ObjectInfo::E( const double theta, const double a, const double b, const
 		 + ( c * cos( theta ) * cos( theta ) );
 }
 
+// ---------------------------------------------------------------------------
+// Add
+// Purpose: Accumulates the area and moments of another part of the object.
+// ---------------------------------------------------------------------------
+void ObjectInfo::add( const ObjectInfo& part ){
+
+	features_valid = false;
+	area += part.area;
+	eei += part.eei;
+	eej += part.eej;
+	eei2 += part.eei2;
+	eej2 += part.eej2;
+	eeij += part.eeij;
+
+	eei3 += part.eei3;
+	eej3 += part.eej3;
+	eei2j += part.eei2j;
+	eeij2 += part.eeij2;
+
+	perimeter += part.perimeter;
+	if( part.min_row < min_row ) min_row = part.min_row;
+	if( part.min_col < min_col ) min_col = part.min_col;
+	if( part.max_row > max_row ) max_row = part.max_row;
+	if( part.max_col > max_col ) max_col = part.max_col;
+}
+
 // ---------------------------------------------------------------------------
 // GETTER FUNCTIONS
 // Purpose: Encapsulate class objects to facilitate proper OOP.
 // Returns: Respective values
 // ---------------------------------------------------------------------------
 
-int ObjectInfo::getArea() const{
+long long ObjectInfo::getArea() const{
 	return area;
 }
 
-int ObjectInfo::getEEi() const{
+long long ObjectInfo::getEEi() const{
 	return eei;
 }
 
-int ObjectInfo::getEEj() const{
+long long ObjectInfo::getEEj() const{
 	return eej;
 }
 
-int ObjectInfo::getEEi2() const{
+long long ObjectInfo::getEEi2() const{
 	return eei2;
 }
 
-int ObjectInfo::getEEj2() const{
+long long ObjectInfo::getEEj2() const{
 	return eej2;
 }
 
-int ObjectInfo::getEEij() const{
+long long ObjectInfo::getEEij() const{
 	return eeij;
 }
 
+long long ObjectInfo::getPerimeter() const{
+	return perimeter;
+}
+
+int ObjectInfo::getMinRow() const{
+	return min_row;
+}
+
+int ObjectInfo::getMinCol() const{
+	return min_col;
+}
+
+int ObjectInfo::getMaxRow() const{
+	return max_row;
+}
+
+int ObjectInfo::getMaxCol() const{
+	return max_col;
+}
+
 // ---------------------------------------------------------------------------
 // SETTER FUNCTIONS
 // Purpose: Encapsulate class objects to facilitate proper OOP.
 // Returns: Respective values
 // ---------------------------------------------------------------------------
 
-void ObjectInfo::setArea( const int i ){
+void ObjectInfo::setArea( const long long i ){
+	features_valid = false;
 	if( i >= 0 ) area = i;
 	else throw std::invalid_argument("Can't set area to negative value!");
 }
 
-void ObjectInfo::setEEi( const int i ){
+void ObjectInfo::setEEi( const long long i ){
+	features_valid = false;
 	if( i >= 0 ) eei = i;
 	else throw std::invalid_argument("Can't set EEi to negative value!");
 }
 
-void ObjectInfo::setEEj( const int i ){
+void ObjectInfo::setEEj( const long long i ){
+	features_valid = false;
 	if( i >= 0 ) eej = i;
 	else throw std::invalid_argument("Can't set EEj to negative value!");
 }
 
-void ObjectInfo::setEEi2( const int i ){
+void ObjectInfo::setEEi2( const long long i ){
+	features_valid = false;
 	if( i >= 0 ) eei2 = i;
 	else throw std::invalid_argument("Can't set EEi2 to negative value!");
 }
 
-void ObjectInfo::setEEj2( const int i ){
+void ObjectInfo::setEEj2( const long long i ){
+	features_valid = false;
 	if( i >= 0 ) eej2 = i;
 	else throw std::invalid_argument("Can't set EEj2 to negative value!");
 }
 
-void ObjectInfo::setEEij( const int i ){
+void ObjectInfo::setEEij( const long long i ){
+	features_valid = false;
 	if( i >= 0 ) eeij = i;
 	else throw std::invalid_argument("Can't set EEij to negative value!");
 }
\ No newline at end of file
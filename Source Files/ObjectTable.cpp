@@ -0,0 +1,267 @@
+// ---------------------------------------------------------------------------
+// ObjectTable.cpp
+// Area and moments of every object of a labeled image, one array per
+// quantity indexed by label.
+// ---------------------------------------------------------------------------
+
+#include "ObjectTable.h"
+#include "Parallel.h"
+#include "RunLengthImage.h"
+#include <algorithm>
+#include <climits>
+
+ObjectTable::ObjectTable( const int labels ){ resize( labels ); }
+
+// ---------------------------------------------------------------------------
+// Row_Runs
+// Purpose: Finds the runs of equal, non-zero grey level (or label) of a row.
+//
+// Parameters:
+//		1: Row
+//		2: Number of columns
+//		3: Out: runs, labeled with their grey level
+// ---------------------------------------------------------------------------
+template< typename T >
+static void row_runs( const T* pixels, const int cols, std::vector< Run >& runs ){
+
+	runs.clear();
+	for( int j = 0; j < cols; ){
+
+		if( !pixels[ j ] ){
+			j++;
+			continue;
+		}
+
+		Run run;
+		run.start = j;
+		run.label = pixels[ j ];
+		while( j < cols && pixels[ j ] == run.label )
+			j++;
+		run.end = j;
+
+		runs.push_back( run );
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Same_Label_Overlap
+// Purpose: Number of columns a run shares with runs of the same label in a
+//			neighbouring row. Runs are visited in column order, so the
+//			runs of the other row are walked once with a shared position.
+//
+// Parameters:
+//		1: Run
+//		2: Runs of the neighbouring row
+//		3: In/out: first run of the row that may still overlap
+// ---------------------------------------------------------------------------
+static int same_label_overlap( const Run& run, const std::vector< Run >& row, size_t& k ){
+
+	while( k < row.size() && row[ k ].end <= run.start )
+		k++;
+
+	int overlap = 0;
+	for( size_t m = k; m < row.size() && row[ m ].start < run.end; m++ ){
+		if( row[ m ].label == run.label )
+			overlap += std::min( run.end, row[ m ].end ) - std::max( run.start, row[ m ].start );
+	}
+	return overlap;
+}
+
+// ---------------------------------------------------------------------------
+// Measure
+// Purpose: Measures every non-zero value of rows of grey levels or labels,
+//			each band of rows into its own table on its own thread, then
+//			sums the band tables.
+//
+//			Each row is split into runs of equal value, and each run is
+//			added in closed form. A run has edges to other pixels at both
+//			ends, and above and below wherever it doesn't overlap a run of
+//			its own value.
+//
+// Parameters:
+//		1: Out: table
+//		2: First row
+//		3: Elements from one row to the next
+//		4: Number of rows
+//		5: Number of columns
+//		6: Number of labels, values are below it
+// ---------------------------------------------------------------------------
+template< typename T >
+static void measure( ObjectTable& table, const T* data, const size_t stride,
+					 const int rows, const int cols, const int labels ){
+
+	const int bands = band_count( rows );
+
+	// One table per band
+	std::vector< ObjectTable > band_tables( bands, ObjectTable( labels ) );
+
+	parallel_bands( rows, [ & ]( const int first, const int last, const int band ){
+
+		ObjectTable& band_table = band_tables[ band ];
+
+		// Runs of the rows above, at and below row i
+		std::vector< Run > above, runs, below;
+		if( first > 0 )
+			row_runs( data + ( first - 1 ) * stride, cols, above );
+		row_runs( data + first * stride, cols, runs );
+
+		for( int i = first; i < last; i++ ){
+
+			if( i + 1 < rows )
+				row_runs( data + ( i + 1 ) * stride, cols, below );
+			else
+				below.clear();
+
+			size_t k_above = 0, k_below = 0;
+			for( size_t r = 0; r < runs.size(); r++ ){
+
+				const Run& run = runs[ r ];
+				const int n = run.end - run.start;
+				const int edges = 2 + ( n - same_label_overlap( run, above, k_above ) )
+									+ ( n - same_label_overlap( run, below, k_below ) );
+
+				band_table.add_run( run.label, i, run.start, run.end, edges );
+			}
+
+			above.swap( runs );
+			runs.swap( below );
+		}
+	}, bands );
+
+	table = band_tables[ 0 ];
+	for( int b = 1; b < bands; b++ )
+		table.add( band_tables[ b ] );
+}
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Measures every grey level of a labeled image but 0.
+// ---------------------------------------------------------------------------
+ObjectTable::ObjectTable( const Image& image ){
+
+	// Grey levels are bytes
+	measure( *this, image.getData(), image.getStride(), image.getNRows(), image.getNCols(), 256 );
+}
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Measures every label of a label plane but 0.
+// ---------------------------------------------------------------------------
+ObjectTable::ObjectTable( const int* labels, const int rows, const int cols, const int label_count ){
+
+	measure( *this, labels, (size_t)cols, rows, cols, label_count );
+}
+
+// ---------------------------------------------------------------------------
+// Resize
+// Purpose: Sizes every array for labels [0, labels), all zero.
+// ---------------------------------------------------------------------------
+void ObjectTable::resize( const int labels ){
+
+	area.assign( labels, 0 );
+	eei.assign( labels, 0 );
+	eej.assign( labels, 0 );
+	eei2.assign( labels, 0 );
+	eej2.assign( labels, 0 );
+	eeij.assign( labels, 0 );
+	eei3.assign( labels, 0 );
+	eej3.assign( labels, 0 );
+	eei2j.assign( labels, 0 );
+	eeij2.assign( labels, 0 );
+
+	perimeter.assign( labels, 0 );
+	min_row.assign( labels, INT_MAX );
+	min_col.assign( labels, INT_MAX );
+	max_row.assign( labels, -1 );
+	max_col.assign( labels, -1 );
+}
+
+// ---------------------------------------------------------------------------
+// Add
+// Purpose: Accumulates part of an object into the object with the label.
+// ---------------------------------------------------------------------------
+void ObjectTable::add( const int label, const ObjectInfo& part ){
+
+	area[ label ] += part.area;
+	eei[ label ] += part.eei;
+	eej[ label ] += part.eej;
+	eei2[ label ] += part.eei2;
+	eej2[ label ] += part.eej2;
+	eeij[ label ] += part.eeij;
+	eei3[ label ] += part.eei3;
+	eej3[ label ] += part.eej3;
+	eei2j[ label ] += part.eei2j;
+	eeij2[ label ] += part.eeij2;
+
+	perimeter[ label ] += part.perimeter;
+	min_row[ label ] = std::min( min_row[ label ], part.min_row );
+	min_col[ label ] = std::min( min_col[ label ], part.min_col );
+	max_row[ label ] = std::max( max_row[ label ], part.max_row );
+	max_col[ label ] = std::max( max_col[ label ], part.max_col );
+}
+
+// ---------------------------------------------------------------------------
+// Add
+// Purpose: Accumulates another table of the same size, label by label.
+// ---------------------------------------------------------------------------
+void ObjectTable::add( const ObjectTable& other ){
+
+	for( int label = 0; label < size(); label++ ){
+		area[ label ] += other.area[ label ];
+		eei[ label ] += other.eei[ label ];
+		eej[ label ] += other.eej[ label ];
+		eei2[ label ] += other.eei2[ label ];
+		eej2[ label ] += other.eej2[ label ];
+		eeij[ label ] += other.eeij[ label ];
+		eei3[ label ] += other.eei3[ label ];
+		eej3[ label ] += other.eej3[ label ];
+		eei2j[ label ] += other.eei2j[ label ];
+		eeij2[ label ] += other.eeij2[ label ];
+
+		perimeter[ label ] += other.perimeter[ label ];
+		min_row[ label ] = std::min( min_row[ label ], other.min_row[ label ] );
+		min_col[ label ] = std::min( min_col[ label ], other.min_col[ label ] );
+		max_row[ label ] = std::max( max_row[ label ], other.max_row[ label ] );
+		max_col[ label ] = std::max( max_col[ label ], other.max_col[ label ] );
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Get
+// Purpose: Area and moments of the object with the label.
+// ---------------------------------------------------------------------------
+ObjectInfo ObjectTable::get( const int label ) const{
+
+	ObjectInfo object;
+	object.area = area[ label ];
+	object.eei = eei[ label ];
+	object.eej = eej[ label ];
+	object.eei2 = eei2[ label ];
+	object.eej2 = eej2[ label ];
+	object.eeij = eeij[ label ];
+	object.eei3 = eei3[ label ];
+	object.eej3 = eej3[ label ];
+	object.eei2j = eei2j[ label ];
+	object.eeij2 = eeij2[ label ];
+
+	object.perimeter = perimeter[ label ];
+	object.min_row = min_row[ label ];
+	object.min_col = min_col[ label ];
+	object.max_row = max_row[ label ];
+	object.max_col = max_col[ label ];
+	return object;
+}
+
+// ---------------------------------------------------------------------------
+// To_Map
+// Purpose: Every object, label -> object info, in label order.
+// ---------------------------------------------------------------------------
+std::map< int, ObjectInfo > ObjectTable::to_map( void ) const{
+
+	std::map< int, ObjectInfo > objects;
+	for( int label = 0; label < size(); label++ ){
+		if( area[ label ] )
+			objects.insert( objects.end(), std::make_pair( label, get( label ) ) );
+	}
+	return objects;
+}
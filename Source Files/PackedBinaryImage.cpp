@@ -0,0 +1,114 @@
+// ---------------------------------------------------------------------------
+// PackedBinaryImage.cpp
+// Binary image stored one bit per pixel, 64 pixels per word.
+// ---------------------------------------------------------------------------
+
+#include "PackedBinaryImage.h"
+#include "Threshold.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+PackedBinaryImage::PackedBinaryImage( void ) : rows( 0 ), cols( 0 ), words_per_row( 0 ){ }
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Constructs an all background packed image.
+// ---------------------------------------------------------------------------
+PackedBinaryImage::PackedBinaryImage( const int rows, const int cols ){
+
+	setSize( rows, cols );
+}
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Thresholds a greyscale image straight into packed form.
+// ---------------------------------------------------------------------------
+PackedBinaryImage::PackedBinaryImage( const Image& image, const int threshold ){
+
+	setSize( image.getNRows(), image.getNCols() );
+
+	for( int i = 0; i < rows; i++ )
+		threshold_row_mask( image.getRow( i ), getRow( i ), cols, threshold );
+}
+
+// ---------------------------------------------------------------------------
+// SetSize
+// Purpose: Resizes the image and clears every pixel to background.
+// ---------------------------------------------------------------------------
+void PackedBinaryImage::setSize( const int rows, const int cols ){
+
+	if( rows < 0 || cols < 0 )
+		throw std::invalid_argument( "Image size can't be negative" );
+
+	this->rows = rows;
+	this->cols = cols;
+	words_per_row = ( cols + 63 ) / 64;
+	bits.assign( (size_t)rows * words_per_row, 0 );
+}
+
+void PackedBinaryImage::setPixel( const int i, const int j, const bool value ){
+
+	uint64_t& word = getRow( i )[ j >> 6 ];
+	const uint64_t bit = (uint64_t)1 << ( j & 63 );
+
+	word = value ? ( word | bit ) : ( word & ~bit );
+}
+
+// ---------------------------------------------------------------------------
+// Next_Run
+// Purpose: Finds the next run of foreground pixels in a row, skipping
+//			whole background words and locating run ends with ctz.
+// ---------------------------------------------------------------------------
+bool PackedBinaryImage::next_run( const int row, int& start, int& end ) const{
+
+	const uint64_t* r = getRow( row );
+	int w = start >> 6;
+
+	if( start >= cols )
+		return false;
+
+	// First foreground bit at or after start
+	uint64_t word = r[ w ] & ( ~(uint64_t)0 << ( start & 63 ) );
+	while( !word ){
+		if( ++w == words_per_row )
+			return false;
+		word = r[ w ];
+	}
+	start = ( w << 6 ) + __builtin_ctzll( word );
+
+	// First background bit after it
+	word = ~r[ w ] & ( ~(uint64_t)0 << ( start & 63 ) );
+	while( !word ){
+		if( ++w == words_per_row ){
+			end = cols;
+			return true;
+		}
+		word = ~r[ w ];
+	}
+	end = std::min( ( w << 6 ) + __builtin_ctzll( word ), cols );
+
+	return true;
+}
+
+// ---------------------------------------------------------------------------
+// Unpack
+// Purpose: Writes the image out as 0/255 pixels.
+// ---------------------------------------------------------------------------
+void PackedBinaryImage::unpack( Image& image ) const{
+
+	if( image.setSize( rows, cols ) < 0 )
+		throw std::bad_alloc();
+
+	for( int i = 0; i < rows; i++ ){
+
+		unsigned char* dst = image.getRow( i );
+		memset( dst, 0, cols );
+
+		int start = 0, end = 0;
+		while( next_run( i, start, end ) ){
+			memset( dst + start, 255, end - start );
+			start = end;
+		}
+	}
+}
@@ -4,123 +4,348 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include "Image.h"
 
 
 
+/* source of header bytes: a stdio stream or a block of memory */
+typedef struct
+{
+  FILE *file;
+  const unsigned char *data;
+  size_t length;
+  size_t pos;
+} HeaderSource;
+
+static int nextHeaderByte(HeaderSource *src)
+{
+  if (src->file)
+    return fgetc(src->file);
+  if (src->pos>=src->length)
+    return EOF;
+  return src->data[src->pos++];
+}
+
+static int readHeaderNumber(HeaderSource *src, int *value)
+/*
+  skips white space and "#" comments, then reads a decimal number;
+  leaves the character that ended the number consumed;
+
+  returns the ending character, or EOF if no number was found.
+*/
+{
+  int c=nextHeaderByte(src);
+
+  for(;;)
+  {
+    if (c=='#')
+      while (c!='\n' && c!=EOF)
+        c=nextHeaderByte(src);
+    else if (c==' ' || c=='\t' || c=='\r' || c=='\n')
+      c=nextHeaderByte(src);
+    else
+      break;
+  }
+
+  if (c<'0' || c>'9')
+    return EOF;
+
+  *value=0;
+  while (c>='0' && c<='9')
+  {
+    *value=*value*10+(c-'0');
+    c=nextHeaderByte(src);
+  }
+  return c;
+}
+
+static int readHeader(HeaderSource *src, int *nCols, int *nRows, int *levels)
+/*
+  parses a P5 header up to and including the single white space
+  character that separates it from the pixels;
+
+  returns 0 if OK or -1 if this is not a P5 header.
+*/
+{
+  if (nextHeaderByte(src)!='P' || nextHeaderByte(src)!='5')
+    return -1;
+
+  if (readHeaderNumber(src,nCols)==EOF
+      ||readHeaderNumber(src,nRows)==EOF
+      ||readHeaderNumber(src,levels)==EOF
+      ||*nCols<=0 || *nRows<=0)
+    return -1;
+
+  return 0;
+}
+
+static int readPixels(Image *im, FILE *input, int nRows, int nCols)
+/*
+  reads nRows x nCols pixels from input with a single fread, then
+  spreads the rows out to the image's row stride in place
+  (last row first, so no row is overwritten before it is moved);
+
+  returns 0 if OK or -1 on a short file.
+*/
+{
+  int i;
+  unsigned char *data=im->getData();
+
+  if (fread(data,1,(size_t)nRows*nCols,input)!=(size_t)nRows*nCols)
+    return -1;
+
+  if (im->getStride()!=nCols)
+    for(i=nRows-1;i>0;i--)
+      memmove(im->getRow(i),data+(size_t)i*nCols,nCols);
+
+  return 0;
+}
+
 int readImage(Image *im, const char *fname)
 /*
-  reads image from fname;
+  reads image from fname into memory owned by the image;
 
   returns 0 if OK or -1 if something goes wrong.
 */
 {
   FILE *input;
-  char line[1024];
+  HeaderSource src;
   int nCols,nRows;
   int levels;
-  int i, j;
 
   /* open it */
-  if (!fname || (input=fopen(fname,"r"))==0){
+  if (!fname || (input=fopen(fname,"rb"))==0){
     printf("readImage: Cannot open file\n");
     return-1;
   }
 
-  /* check for the right "magic number" */
-  if (
-        fread(line,1,3,input)!=3
-      ||strncmp(line,"P5\n",3)
-     )
+  /* check for the right "magic number" and read the header */
+  memset(&src,0,sizeof src);
+  src.file=input;
+  if (readHeader(&src,&nCols,&nRows,&levels))
   {
     fclose(input);
     printf("readImage: Expected .pgm file\n");
     return -1;
   }
 
-  /* skip the comments */
-  do
-    fgets(line,sizeof line,input);
-  while(*line=='#');
+  if (im->setSize(nRows,nCols)<0)
+  {
+    fclose(input);
+    return -1;
+  }
+  im->setColors(levels);
 
-  /* read the width and height */
-  sscanf(line,"%d %d\n",&nCols,&nRows);
-  im->setSize( nRows, nCols);
+  /* read all the pixels at once */
+  if (readPixels(im,input,nRows,nCols))
+  {
+    fclose(input);
+    printf("readImage: short file\n");
+    return -1;
+  }
+
+  /* close the file */
+  fclose(input);
+  return 0; /* OK */
+}
 
-  /* read # of gray levels */
-  fgets(line,sizeof line,input);
-  sscanf(line,"%d\n",&levels);
+int mapImage(Image *im, const char *fname)
+/*
+  maps fname into memory and makes im a view of the pixels inside
+  the mapping, so nothing is decoded or copied; the mapping is
+  private, so pixels written through im never reach the file (pages
+  are copied by the kernel only when first written);
+  falls back to readImage() when the file cannot be mapped
+  (e.g. a pipe);
+
+  returns 0 if OK or -1 if something goes wrong.
+*/
+{
+  int fd;
+  struct stat info;
+  void *base;
+  HeaderSource src;
+  int nCols,nRows;
+  int levels;
+
+  /* open it */
+  if (!fname || (fd=open(fname,O_RDONLY))<0){
+    printf("mapImage: Cannot open file\n");
+    return -1;
+  }
+
+  if (fstat(fd,&info) || !S_ISREG(info.st_mode) || info.st_size==0
+      ||(base=mmap(NULL,info.st_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0))
+        ==MAP_FAILED)
+  {
+    close(fd);
+    return readImage(im,fname);
+  }
+  close(fd);
+
+  /* check for the right "magic number" and read the header */
+  memset(&src,0,sizeof src);
+  src.data=(const unsigned char *)base;
+  src.length=info.st_size;
+  if (readHeader(&src,&nCols,&nRows,&levels))
+  {
+    munmap(base,info.st_size);
+    printf("mapImage: Expected .pgm file\n");
+    return -1;
+  }
+
+  if (src.length-src.pos<(size_t)nRows*nCols) /* short file */
+  {
+    munmap(base,info.st_size);
+    printf("mapImage: short file\n");
+    return -1;
+  }
+
+  madvise(base,info.st_size,MADV_SEQUENTIAL);
+
+  /* pixels follow the header directly, one row every nCols bytes */
+  im->setMapping((unsigned char *)base+src.pos,nRows,nCols,nCols,
+                 base,info.st_size);
   im->setColors(levels);
+  return 0; /* OK */
+}
+
+static int pgmHeader(const Image *im, char *header, size_t size)
+/*
+  formats the header written in front of the pixels;
+
+  returns the length of the header.
+*/
+{
+  return snprintf(header,size,"P5\n#\n%d %d\n%03d\n",
+                  im->getNCols(),im->getNRows(),im->getColors());
+}
+
+long writeImageBuffer(const Image *im, unsigned char *buffer, size_t size)
+/*
+  writes the image, header and pixels, into buffer if it holds at
+  least the returned number of bytes; pass a NULL buffer to just
+  get the size;
+
+  returns the size of the pgm image in bytes.
+*/
+{
+  char header[64];
+  int nRows=im->getNRows();
+  int nCols=im->getNCols();
+  int length=pgmHeader(im,header,sizeof header);
+  long total=length+(long)nRows*nCols;
+  int i;
+
+  if (!buffer || size<(size_t)total)
+    return total;
+
+  memcpy(buffer,header,length);
+  buffer+=length;
+  if (im->getStride()==nCols)
+    memcpy(buffer,im->getData(),(size_t)nRows*nCols);
+  else
+    for(i=0;i<nRows;i++)
+      memcpy(buffer+(size_t)i*nCols,im->getRow(i),nCols);
+
+  return total;
+}
+
+int writeImageFd(const Image *im, int fd)
+/*
+  writes the image into the already open file descriptor fd,
+  gathering the header and the pixel rows straight from the image
+  buffer with writev (a single iovec for the whole image when its
+  rows are packed);
 
-  /* read pixel row by row */
-  for(i=0;i<nRows;i++)
+  returns 0 if OK or -1 if something goes wrong.
+*/
+{
+  char header[64];
+  struct iovec vec[IOV_MAX];
+  int nRows=im->getNRows();
+  int nCols=im->getNCols();
+  int packed=(im->getStride()==nCols);
+  int next=0; /* next row to queue */
+  int count;
+  ssize_t done;
+
+  vec[0].iov_base=header;
+  vec[0].iov_len=pgmHeader(im,header,sizeof header);
+  count=1;
+
+  while (count>0)
   {
-    for(j=0;j<nCols;j++)
+    /* queue up as many rows as fit */
+    if (packed && next<nRows)
     {
-      int byte=fgetc(input);
-
-      if (byte==EOF) /* short file */
-      {
-        fclose(input);
-        printf("readImage: short file\n");
-        return -1;
-      }
-      else
-        im->setPixel(i,j,byte);
+      vec[count].iov_base=(void *)im->getData();
+      vec[count].iov_len=(size_t)nRows*nCols;
+      count++;
+      next=nRows;
     }
+    for(;next<nRows && count<IOV_MAX;next++,count++)
+    {
+      vec[count].iov_base=(void *)im->getRow(next);
+      vec[count].iov_len=nCols;
+    }
+
+    done=writev(fd,vec,count);
+    if (done<0) /* couldn't write */
+      return -1;
+
+    /* drop what was written, keep a partly written entry */
+    int first=0;
+    while (first<count && (size_t)done>=vec[first].iov_len)
+      done-=vec[first++].iov_len;
+    if (first<count)
+    {
+      vec[first].iov_base=(char *)vec[first].iov_base+done;
+      vec[first].iov_len-=done;
+    }
+    memmove(vec,vec+first,(count-first)*sizeof *vec);
+    count-=first;
   }
 
-  /* close the file */
-  fclose(input);
   return 0; /* OK */
 }
 
-int writeImage(const Image *im, const char *fname)
+int writeImage(const Image *im, const char *fname, int quiet)
 /*
-  writes the image into fname;
+  writes the image into fname; prints the image size unless quiet;
 
   returns 0 if OK or -1 if something goes wrong.
 */
 {
-  FILE *output;
-  int nRows;
-  int nCols;
-  int colors;
-  int i, j;
+  int fd;
 
   /* open the file */
-  if (!fname || (output=fopen(fname,"w"))==0){
+  if (!fname || (fd=open(fname,O_WRONLY|O_CREAT|O_TRUNC,0666))<0){
     printf("writeImage: cannot open file\n");
     return(-1);
   }
-  nRows=im->getNRows();
-  nCols=im->getNCols();
-  colors=im->getColors();
-
-  printf("Saving image of size %d %d\n", nRows, nCols);
-  /* write the header */
-  fprintf(output,"P5\n"); /* magic number */
-  fprintf(output,"#\n");  /* empty comment */
-  fprintf(output,"%d %d\n%03d\n",nCols,nRows,colors); /* image info */
-
-  /* write pixels row by row */
-  for(i=0;i<nRows;i++)
+
+  if (!quiet)
+    printf("Saving image of size %d %d\n", im->getNRows(), im->getNCols());
+
+  if (writeImageFd(im,fd))
   {
-    for(j=0;j<nCols;j++)
-    {
-      int byte=im->getPixel(i,j);
-
-      if (fputc(byte,output)==EOF) /* couldn't write */
-      {
-	    fclose(output);
-            printf("writeImage: could not write\n");
-	    return -1;
-      }
-    }
+    close(fd);
+    printf("writeImage: could not write\n");
+    return -1;
   }
 
   /* close the file */
-  fclose(output);
+  if (close(fd))
+  {
+    printf("writeImage: could not write\n");
+    return -1;
+  }
   return 0; /* OK */
 }
-
@@ -0,0 +1,69 @@
+// ---------------------------------------------------------------------------
+// RunLengthImage.cpp
+// Binary or labeled image stored as horizontal runs of foreground pixels.
+// ---------------------------------------------------------------------------
+
+#include "RunLengthImage.h"
+#include "Threshold.h"
+
+RunLengthImage::RunLengthImage( void ) : cols( 0 ), row_start( 1, 0 ){ }
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Encodes the runs of non-zero pixels of an image. Each row is
+//			packed into bits first, so runs are found a word at a time.
+// ---------------------------------------------------------------------------
+RunLengthImage::RunLengthImage( const Image& image ) : RunLengthImage( image, 0, image.getNRows() ){ }
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Encodes the runs of non-zero pixels of rows [first, last).
+// ---------------------------------------------------------------------------
+RunLengthImage::RunLengthImage( const Image& image, const int first, const int last )
+	: cols( image.getNCols() ), row_start( 1, 0 ){
+
+	PackedBinaryImage row_bits( 1, cols );
+
+	row_start.reserve( last - first + 1 );
+	for( int i = first; i < last; i++ ){
+		threshold_row_mask( image.getRow( i ), row_bits.getRow( 0 ), cols, 1 );
+		add_row_runs( row_bits, 0 );
+	}
+}
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Encodes the runs of set bits of a packed image.
+// ---------------------------------------------------------------------------
+RunLengthImage::RunLengthImage( const PackedBinaryImage& image )
+	: RunLengthImage( image, 0, image.getNRows() ){ }
+
+// ---------------------------------------------------------------------------
+// CONSTRUCTOR
+// Purpose: Encodes the runs of set bits of rows [first, last).
+// ---------------------------------------------------------------------------
+RunLengthImage::RunLengthImage( const PackedBinaryImage& image, const int first, const int last )
+	: cols( image.getNCols() ), row_start( 1, 0 ){
+
+	row_start.reserve( last - first + 1 );
+	for( int i = first; i < last; i++ )
+		add_row_runs( image, i );
+}
+
+// ---------------------------------------------------------------------------
+// Add_Row_Runs
+// Purpose: Appends the runs of a packed row and closes the row.
+// ---------------------------------------------------------------------------
+void RunLengthImage::add_row_runs( const PackedBinaryImage& bits, const int i ){
+
+	Run run;
+	run.start = 0;
+	run.label = 0;
+
+	while( bits.next_run( i, run.start, run.end ) ){
+		runs.push_back( run );
+		run.start = run.end;
+	}
+
+	row_start.push_back( (int)runs.size() );
+}
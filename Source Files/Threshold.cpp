@@ -0,0 +1,361 @@
+// ---------------------------------------------------------------------------
+// Threshold.cpp
+// Row thresholding kernels used to turn grey-level rows into binary rows,
+// in AVX-512, AVX2, SSE2 and plain C++ versions chosen by cpu_level(). Also
+// picks global thresholds automatically from the grey-level histogram.
+// ---------------------------------------------------------------------------
+
+#include "Threshold.h"
+#include "Parallel.h"
+#include "CpuLevel.h"
+#include <cstring>
+#include <cmath>
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Kernels only ever see thresholds in [1, 255], see threshold_row()
+typedef void ( *RowKernel )( const unsigned char*, unsigned char*, int, unsigned char );
+typedef void ( *MaskKernel )( const unsigned char*, uint64_t*, int, unsigned char );
+
+struct Kernels{
+	const char* name;
+	RowKernel row;
+	MaskKernel mask;
+};
+
+// ---------------------------------------------------------------------------
+// Scalar kernels, also used for the tails of the vector kernels
+// ---------------------------------------------------------------------------
+void row_scalar( const unsigned char* src, unsigned char* dst, int length, unsigned char t ){
+
+	for( int j = 0; j < length; j++ )
+		dst[ j ] = ( src[ j ] < t ) ? 0 : 255;
+}
+
+// Packs the last length ( < 64 ) pixels into one word
+uint64_t mask_tail( const unsigned char* src, int length, unsigned char t ){
+
+	uint64_t word = 0;
+	for( int j = 0; j < length; j++ )
+		word |= (uint64_t)( src[ j ] >= t ) << j;
+	return word;
+}
+
+void mask_scalar( const unsigned char* src, uint64_t* bits, int length, unsigned char t ){
+
+	int j = 0;
+	for( ; j + 64 <= length; j += 64 )
+		*bits++ = mask_tail( src + j, 64, t );
+	if( j < length )
+		*bits = mask_tail( src + j, length - j, t );
+}
+
+#ifdef CPU_X86
+
+// ---------------------------------------------------------------------------
+// SSE2 kernels: 16 pixels per compare. max( x, t ) == x  <=>  x >= t
+// ---------------------------------------------------------------------------
+__attribute__(( target( "sse2" ) ))
+void row_sse2( const unsigned char* src, unsigned char* dst, int length, unsigned char t ){
+
+	const __m128i tv = _mm_set1_epi8( (char)t );
+	int j = 0;
+	for( ; j + 16 <= length; j += 16 ){
+		const __m128i x = _mm_loadu_si128( (const __m128i*)( src + j ) );
+		_mm_storeu_si128( (__m128i*)( dst + j ), _mm_cmpeq_epi8( _mm_max_epu8( x, tv ), x ) );
+	}
+	row_scalar( src + j, dst + j, length - j, t );
+}
+
+__attribute__(( target( "sse2" ) ))
+void mask_sse2( const unsigned char* src, uint64_t* bits, int length, unsigned char t ){
+
+	const __m128i tv = _mm_set1_epi8( (char)t );
+	int j = 0;
+	for( ; j + 64 <= length; j += 64 ){
+		uint64_t word = 0;
+		for( int k = 0; k < 4; k++ ){
+			const __m128i x = _mm_loadu_si128( (const __m128i*)( src + j + 16 * k ) );
+			const uint64_t m = (uint16_t)_mm_movemask_epi8( _mm_cmpeq_epi8( _mm_max_epu8( x, tv ), x ) );
+			word |= m << ( 16 * k );
+		}
+		*bits++ = word;
+	}
+	if( j < length )
+		*bits = mask_tail( src + j, length - j, t );
+}
+
+// ---------------------------------------------------------------------------
+// AVX2 kernels: 32 pixels per compare
+// ---------------------------------------------------------------------------
+__attribute__(( target( "avx2" ) ))
+void row_avx2( const unsigned char* src, unsigned char* dst, int length, unsigned char t ){
+
+	const __m256i tv = _mm256_set1_epi8( (char)t );
+	int j = 0;
+	for( ; j + 32 <= length; j += 32 ){
+		const __m256i x = _mm256_loadu_si256( (const __m256i*)( src + j ) );
+		_mm256_storeu_si256( (__m256i*)( dst + j ), _mm256_cmpeq_epi8( _mm256_max_epu8( x, tv ), x ) );
+	}
+	row_scalar( src + j, dst + j, length - j, t );
+}
+
+__attribute__(( target( "avx2" ) ))
+void mask_avx2( const unsigned char* src, uint64_t* bits, int length, unsigned char t ){
+
+	const __m256i tv = _mm256_set1_epi8( (char)t );
+	int j = 0;
+	for( ; j + 64 <= length; j += 64 ){
+		const __m256i lo = _mm256_loadu_si256( (const __m256i*)( src + j ) );
+		const __m256i hi = _mm256_loadu_si256( (const __m256i*)( src + j + 32 ) );
+		const uint64_t mlo = (uint32_t)_mm256_movemask_epi8( _mm256_cmpeq_epi8( _mm256_max_epu8( lo, tv ), lo ) );
+		const uint64_t mhi = (uint32_t)_mm256_movemask_epi8( _mm256_cmpeq_epi8( _mm256_max_epu8( hi, tv ), hi ) );
+		*bits++ = mlo | ( mhi << 32 );
+	}
+	if( j < length )
+		*bits = mask_tail( src + j, length - j, t );
+}
+
+// ---------------------------------------------------------------------------
+// AVX-512 kernels: 64 pixels per compare, straight into a mask register
+// ---------------------------------------------------------------------------
+__attribute__(( target( "avx512f,avx512bw" ) ))
+void row_avx512( const unsigned char* src, unsigned char* dst, int length, unsigned char t ){
+
+	const __m512i tv = _mm512_set1_epi8( (char)t );
+	int j = 0;
+	for( ; j + 64 <= length; j += 64 ){
+		const __m512i x = _mm512_loadu_si512( (const void*)( src + j ) );
+		_mm512_storeu_si512( (void*)( dst + j ), _mm512_movm_epi8( _mm512_cmpge_epu8_mask( x, tv ) ) );
+	}
+	row_scalar( src + j, dst + j, length - j, t );
+}
+
+__attribute__(( target( "avx512f,avx512bw" ) ))
+void mask_avx512( const unsigned char* src, uint64_t* bits, int length, unsigned char t ){
+
+	const __m512i tv = _mm512_set1_epi8( (char)t );
+	int j = 0;
+	for( ; j + 64 <= length; j += 64 ){
+		const __m512i x = _mm512_loadu_si512( (const void*)( src + j ) );
+		*bits++ = _mm512_cmpge_epu8_mask( x, tv );
+	}
+	if( j < length )
+		*bits = mask_tail( src + j, length - j, t );
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// Select_Kernels
+// Purpose: Picks the widest kernels this CPU can run.
+// ---------------------------------------------------------------------------
+Kernels select_kernels( void ){
+
+#ifdef CPU_X86
+	// Byte lanes need AVX-512BW
+	const CpuLevel level = cpu_level();
+
+	if( level >= CPU_AVX512BW ){
+		Kernels k = { "avx512", row_avx512, mask_avx512 };
+		return k;
+	}
+	if( level >= CPU_AVX2 ){
+		Kernels k = { "avx2", row_avx2, mask_avx2 };
+		return k;
+	}
+	if( level >= CPU_SSE2 ){
+		Kernels k = { "sse2", row_sse2, mask_sse2 };
+		return k;
+	}
+#endif
+	Kernels k = { "scalar", row_scalar, mask_scalar };
+	return k;
+}
+
+const Kernels& kernels( void ){
+
+	static const Kernels selected = select_kernels();
+	return selected;
+}
+
+}
+
+// ---------------------------------------------------------------------------
+// Threshold_Row
+// Purpose: Writes 255 to dst for every pixel of src at or above the
+//			threshold value and 0 for every pixel below it.
+// ---------------------------------------------------------------------------
+void threshold_row( const unsigned char* src, unsigned char* dst,
+					const int length, const int threshold ){
+
+	// Every pixel is at or above thresholds <= 0, none reaches one > 255
+	if( threshold <= 0 )
+		memset( dst, 255, length );
+	else if( threshold > 255 )
+		memset( dst, 0, length );
+	else
+		kernels().row( src, dst, length, (unsigned char)threshold );
+}
+
+// ---------------------------------------------------------------------------
+// Threshold_Row_Mask
+// Purpose: Packs the thresholded row into bits, 64 pixels per word.
+// ---------------------------------------------------------------------------
+void threshold_row_mask( const unsigned char* src, uint64_t* bits,
+						 const int length, const int threshold ){
+
+	const int words = ( length + 63 ) / 64;
+
+	if( threshold <= 0 ){
+		for( int w = 0; w < words; w++ )
+			bits[ w ] = ~(uint64_t)0;
+		if( length % 64 )
+			bits[ words - 1 ] = ( (uint64_t)1 << ( length % 64 ) ) - 1;
+	}
+	else if( threshold > 255 )
+		memset( bits, 0, words * sizeof( uint64_t ) );
+	else
+		kernels().mask( src, bits, length, (unsigned char)threshold );
+}
+
+// ---------------------------------------------------------------------------
+// Threshold_Kernel_Name
+// Purpose: Name of the instruction set the kernels run with on this CPU.
+// ---------------------------------------------------------------------------
+const char* threshold_kernel_name( void ){ return kernels().name; }
+
+// ---------------------------------------------------------------------------
+// Compute_Histogram
+// Purpose: Counts the pixels of each grey level in one pass over the image,
+//			one sub-histogram per row band.
+// ---------------------------------------------------------------------------
+void compute_histogram( const Image& image, unsigned long histogram[ 256 ] ){
+
+	const int rows = image.getNRows();
+	const int cols = image.getNCols();
+	const int bands = band_count( rows );
+
+	std::vector< unsigned long > partial( (size_t)bands * 256, 0 );
+
+	parallel_bands( rows, [ & ]( const int first, const int last, const int band ){
+
+		// Four interleaved counters keep runs of equal pixels from
+		// stalling on the same counter
+		std::vector< unsigned long > counts( 4 * 256, 0 );
+		unsigned long* const c = &counts[ 0 ];
+
+		for( int i = first; i < last; i++ ){
+
+			const unsigned char* row = image.getRow( i );
+			int j = 0;
+			for( ; j + 4 <= cols; j += 4 ){
+				c[ row[ j ] ]++;
+				c[ 256 + row[ j + 1 ] ]++;
+				c[ 512 + row[ j + 2 ] ]++;
+				c[ 768 + row[ j + 3 ] ]++;
+			}
+			for( ; j < cols; j++ )
+				c[ row[ j ] ]++;
+		}
+
+		unsigned long* const out = &partial[ (size_t)band * 256 ];
+		for( int v = 0; v < 256; v++ )
+			out[ v ] = c[ v ] + c[ 256 + v ] + c[ 512 + v ] + c[ 768 + v ];
+	}, bands );
+
+	// Merge the sub-histograms
+	for( int v = 0; v < 256; v++ ){
+		histogram[ v ] = 0;
+		for( int b = 0; b < bands; b++ )
+			histogram[ v ] += partial[ (size_t)b * 256 + v ];
+	}
+}
+
+// ---------------------------------------------------------------------------
+// Otsu_Threshold
+// Purpose: Picks the threshold that maximizes the between-class variance of
+//			the background and foreground grey levels (Otsu's method).
+// ---------------------------------------------------------------------------
+int otsu_threshold( const unsigned long histogram[ 256 ] ){
+
+	double total = 0, total_sum = 0;
+	for( int v = 0; v < 256; v++ ){
+		total += histogram[ v ];
+		total_sum += (double)v * histogram[ v ];
+	}
+
+	// Background is [0, v], foreground is [v + 1, 255]
+	double background = 0, background_sum = 0;
+	double best_variance = -1;
+	int best = 0;
+
+	for( int v = 0; v < 255; v++ ){
+
+		background += histogram[ v ];
+		background_sum += (double)v * histogram[ v ];
+
+		const double foreground = total - background;
+		if( background == 0 || foreground == 0 )
+			continue;
+
+		const double mean_difference = background_sum / background
+									 - ( total_sum - background_sum ) / foreground;
+		const double variance = background * foreground * mean_difference * mean_difference;
+
+		if( variance > best_variance ){
+			best_variance = variance;
+			best = v;
+		}
+	}
+
+	return best + 1;
+}
+
+// ---------------------------------------------------------------------------
+// Triangle_Threshold
+// Purpose: Picks the threshold at the histogram bin farthest from the line
+//			joining the histogram peak to the end of its longer tail.
+// ---------------------------------------------------------------------------
+int triangle_threshold( const unsigned long histogram[ 256 ] ){
+
+	int low = 0, high = 255, peak = 0;
+
+	while( low < 255 && histogram[ low ] == 0 )
+		low++;
+	while( high > 0 && histogram[ high ] == 0 )
+		high--;
+	for( int v = low; v <= high; v++ )
+		if( histogram[ v ] > histogram[ peak ] )
+			peak = v;
+
+	if( low >= high )
+		return low + 1;
+
+	// Walk the longer tail, from its end to the peak
+	const int end = ( peak - low > high - peak ) ? low : high;
+	const int step = ( end < peak ) ? 1 : -1;
+
+	// Distance to the line, up to a constant factor
+	const double dx = peak - end;
+	const double dy = (double)histogram[ peak ] - (double)histogram[ end ];
+
+	double best_distance = -1;
+	int best = end;
+	for( int v = end; v != peak; v += step ){
+
+		const double distance = std::fabs( dy * ( v - end ) - dx * ( (double)histogram[ v ] - (double)histogram[ end ] ) );
+		if( distance > best_distance ){
+			best_distance = distance;
+			best = v;
+		}
+	}
+
+	// The bin itself goes with the peak side: at or above the threshold
+	// when the peak is above the tail, below it otherwise
+	return ( end < peak ) ? best : best + 1;
+}